@@ -2,15 +2,17 @@
 """
 analyze.py
 
-Usage: python3 analyze.py [out.jsonl]
+Usage: python3 analyze.py [out.jsonl | out.bin | capture-dir [from_ms to_ms]]
 
-Reads a JSON-lines file produced by `client1` (timestamp,out1,out2,out3),
+Reads a JSON-lines or binary (-o bin, see scbin.py) file produced by
+`client1` (timestamp,out1,out2,out3),
 plots the three signals, computes dominant frequency, peak-to-peak amplitude,
 RMS and makes a simple waveform-shape estimate for each signal.
 
 Produces a PNG `analysis.png` and prints numeric results.
 """
 
+import os
 import sys
 import json
 import math
@@ -18,8 +20,27 @@ import numpy as np
 import matplotlib.pyplot as plt
 from scipy.fft import rfft, rfftfreq
 
+import scbin
 
-def parse_file(path):
+
+def binary_column(rec, name):
+    # plain stream, or the last/mean column of an aggregated one
+    for col in (name, name + '.last', name + '.mean'):
+        if col in rec.columns:
+            return rec[col]
+    return [math.nan] * len(rec)
+
+
+def parse_file(path, t_from_ms=None, t_to_ms=None):
+    if os.path.isdir(path) or scbin.is_binary(path):
+        if os.path.isdir(path):
+            # seek through the capture index instead of reading everything
+            to_ns = lambda ms: None if ms is None else int(ms * 1e6)
+            rec = scbin.Capture(path).range(to_ns(t_from_ms), to_ns(t_to_ms))
+        else:
+            rec = scbin.read(path)
+        cols = [binary_column(rec, n) for n in ('out1', 'out2', 'out3')]
+        return np.asarray(rec.ts_ms, dtype=float), list(zip(*cols))
     timestamps = []
     streams = []
     with open(path, 'r') as f:
@@ -31,15 +52,23 @@ def parse_file(path):
                 obj = json.loads(line)
             except Exception:
                 continue
-            timestamps.append(obj.get('timestamp'))
+            if 'analysis' in obj:
+                continue    # client -F record, not a window
+            ts = obj.get('timestamp')
+            if ts is None and 'timestamp_us' in obj:
+                ts = obj['timestamp_us'] / 1000.0    # client -u
+            timestamps.append(ts)
             streams.append((obj.get('out1'), obj.get('out2'), obj.get('out3')))
     return np.array(timestamps, dtype=float), streams
 
 
 def to_numeric(arr):
-    # arr is list of strings like '1.23' or '--'
+    # arr is list of strings like '1.23' or '--', numbers (client -n) or
+    # aggregate objects (client -a), which contribute their last/mean
     out = np.full(len(arr), np.nan, dtype=float)
     for i, v in enumerate(arr):
+        if isinstance(v, dict):
+            v = v.get('last', v.get('mean'))
         if v is None:
             out[i] = np.nan
             continue
@@ -199,7 +228,9 @@ def main(argv):
         path = argv[1]
     else:
         path = 'out2.json'
-    t_ms, streams = parse_file(path)
+    t_from = float(argv[2]) if len(argv) > 2 else None
+    t_to = float(argv[3]) if len(argv) > 3 else None
+    t_ms, streams = parse_file(path, t_from, t_to)
     if len(t_ms) == 0:
         print('No data found in', path)
         return 1
@@ -0,0 +1,186 @@
+#!/usr/bin/env python3
+"""
+scbin.py
+
+Reader for the clients' binary output (-o bin, layout in sigclient/binfmt.h).
+
+    import scbin
+    rec = scbin.read('out.bin')
+    rec.columns        # ['out1', 'out2', 'out3.mean', ...]
+    rec.ts_ns          # epoch ns per tick
+    rec['out1']        # values, NaN where absent
+    rec.present('out1')  # flags from the presence bitmap
+
+Plain Python (struct), so it works without numpy.
+
+A capture that was cut off mid-record is read up to the last whole record.
+
+Capture directories (-C dir) are read through their index, loading only
+the records of the requested time range:
+
+    cap = scbin.Capture('capture/')
+    rec = cap.range(t0_ns, t1_ns)   # either bound may be None
+"""
+
+import bisect
+import mmap
+import os
+import struct
+import sys
+
+MAGIC = b'SCB1'
+VERSION = 1
+SYNC = 0x31524353
+HEADER = struct.Struct('<4sHHIIq')
+COLNAME_MAX = 48
+
+INDEX_MAGIC = b'SCIX'
+INDEX_HEADER = struct.Struct('<4sIII')
+INDEX_ENTRY = struct.Struct('<IIqqQ')
+SEGMENT_FMT = 'seg-{:06d}.scb'
+
+
+class Records:
+    def __init__(self, columns, window_ns, raw):
+        self.columns = columns
+        self.window_ns = window_ns
+        n = len(columns)
+        bitmap = ((n + 63) // 64) * 8
+        self.record = struct.Struct(f'<IIq{bitmap}s{n}d')
+        whole = len(raw) - len(raw) % self.record.size
+        self.seq, self.ts_ns, self._bits, self._values = [], [], [], []
+        for sync, seq, ts, bits, *vals in self.record.iter_unpack(raw[:whole]):
+            if sync != SYNC:
+                raise ValueError('corrupt record stream (bad sync word)')
+            self.seq.append(seq)
+            self.ts_ns.append(ts)
+            self._bits.append(bits)
+            self._values.append(vals)
+
+    def __len__(self):
+        return len(self.ts_ns)
+
+    @property
+    def ts_ms(self):
+        return [t / 1e6 for t in self.ts_ns]
+
+    def index(self, name):
+        return self.columns.index(name)
+
+    def __getitem__(self, name):
+        k = self.index(name)
+        return [v[k] for v in self._values]
+
+    def present(self, name):
+        k = self.index(name)
+        return [(b[k // 8] >> (k % 8)) & 1 == 1 for b in self._bits]
+
+
+def parse_header(buf):
+    """Returns (columns, window_ns, header_size, record_size)."""
+    if len(buf) < HEADER.size or buf[:4] != MAGIC:
+        raise ValueError('not a sigclient binary capture')
+    magic, version, ncols, header_size, record_size, window_ns = HEADER.unpack_from(buf)
+    if version != VERSION:
+        raise ValueError(f'unsupported version {version}')
+    columns = []
+    off = HEADER.size
+    for _ in range(ncols):
+        name = buf[off:off + COLNAME_MAX].split(b'\0', 1)[0].decode()
+        columns.append(name)
+        off += COLNAME_MAX
+    return columns, window_ns, header_size, record_size
+
+
+def is_binary(path):
+    with open(path, 'rb') as f:
+        return f.read(4) == MAGIC
+
+
+def loads(buf):
+    columns, window_ns, header_size, record_size = parse_header(buf)
+    rec = Records(columns, window_ns, memoryview(buf)[header_size:])
+    if rec.record.size != record_size:
+        raise ValueError('record size does not match the column table')
+    return rec
+
+
+def read(path):
+    with open(path, 'rb') as f:
+        return loads(f.read())
+
+
+class Segment:
+    def __init__(self, dirpath, segment, is_open, first_ns, last_ns, records):
+        self.path = os.path.join(dirpath, SEGMENT_FMT.format(segment))
+        self.open = bool(is_open)
+        self.first_ns = first_ns
+        self.last_ns = last_ns
+        self.records = records
+
+
+class _Timestamps:
+    """Sequence view of the record timestamps of a mapped segment."""
+
+    def __init__(self, buf, header_size, record_size, count):
+        self.buf, self.base, self.size, self.count = buf, header_size + 8, record_size, count
+
+    def __len__(self):
+        return self.count
+
+    def __getitem__(self, i):
+        return struct.unpack_from('<q', self.buf, self.base + i * self.size)[0]
+
+
+class Capture:
+    def __init__(self, dirpath):
+        self.dir = dirpath
+        with open(os.path.join(dirpath, 'index'), 'rb') as f:
+            buf = f.read()
+        magic, version, count, capacity = INDEX_HEADER.unpack_from(buf)
+        if magic != INDEX_MAGIC or version != 1:
+            raise ValueError('not a sigclient capture index')
+        self.segments = [Segment(dirpath, *INDEX_ENTRY.unpack_from(buf, INDEX_HEADER.size + k * INDEX_ENTRY.size))
+                         for k in range(count)]
+
+    def range(self, t0_ns=None, t1_ns=None):
+        """Records with t0_ns <= ts_ns <= t1_ns from the segments that overlap."""
+        lo_t = -2**63 if t0_ns is None else t0_ns
+        hi_t = 2**63 - 1 if t1_ns is None else t1_ns
+        schema, window_ns, raw = None, 0, bytearray()
+        for seg in self.segments:
+            if seg.records == 0 or seg.last_ns < lo_t or seg.first_ns > hi_t:
+                continue
+            with open(seg.path, 'rb') as f, mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mm:
+                columns, window_ns, header_size, record_size = parse_header(mm)
+                if schema is not None and columns != schema:
+                    raise ValueError(f'{seg.path}: columns differ from earlier segments')
+                schema = columns
+                ts = _Timestamps(mm, header_size, record_size, seg.records)
+                lo = bisect.bisect_left(ts, lo_t)
+                hi = bisect.bisect_right(ts, hi_t)
+                raw += mm[header_size + lo * record_size:header_size + hi * record_size]
+        return Records(schema or [], window_ns, bytes(raw))
+
+
+def main(argv):
+    if len(argv) < 2:
+        print('usage: scbin.py file.bin | capture-dir', file=sys.stderr)
+        return 2
+    if os.path.isdir(argv[1]):
+        cap = Capture(argv[1])
+        for seg in cap.segments:
+            state = ' (open)' if seg.open else ''
+            print(f'{seg.path}: {seg.records} records, {seg.first_ns}..{seg.last_ns}{state}')
+        rec = cap.range()
+    else:
+        rec = read(argv[1])
+    print(f'{len(rec)} records, window {rec.window_ns / 1e6:g} ms, columns: {", ".join(rec.columns)}')
+    for i in range(min(len(rec), 5)):
+        vals = ', '.join(f'{c}={rec[c][i]:g}' if rec.present(c)[i] else f'{c}=--' for c in rec.columns)
+        print(f'  {rec.ts_ns[i]} seq {rec.seq[i]}: {vals}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
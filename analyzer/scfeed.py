@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+scfeed.py
+
+Reader for the clients' shared-memory output ring (-P shm=name, layout in
+sigclient/feed.h).
+
+    import scfeed
+    feed = scfeed.Feed('sigclient')     # /dev/shm/sigclient
+    feed.format, feed.header           # 'json' or 'bin'; bin schema header
+    for rec in feed.records():         # bytes, from the newest record on
+        ...
+    feed.lost                          # records overwritten before read
+
+Every reader keeps its own cursor, so any number of them can follow one
+client without the client doing more work. A reader that falls more than
+the ring behind skips to the oldest record still there and counts what it
+missed in lost.
+
+    scfeed.py name [--all]    copy the records to stdout as the client
+                              writes them (bin: schema header first);
+                              --all starts at the oldest record kept
+"""
+
+import mmap
+import os
+import struct
+import sys
+import time
+
+MAGIC = b'SCF1'
+VERSION = 2
+WRITING = (1 << 64) - 1
+FORMATS = ('json', 'bin')
+
+PAGE = struct.Struct('=4sIIIIIIIqQQ')
+SLOT = struct.Struct('=QII')
+HEAD = PAGE.size - 8
+
+
+class Feed:
+    def __init__(self, name):
+        path = os.path.join('/dev/shm', name.lstrip('/'))
+        with open(path, 'rb') as f:
+            self.mm = mmap.mmap(f.fileno(), 0, prot=mmap.PROT_READ)
+        (magic, version, fmt, self.nslots, self.slot_size, header_size, self.pid, _,
+         self.window_ns, self.slots_offset, _) = PAGE.unpack_from(self.mm)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f'{path}: not an output ring (version {VERSION})')
+        self.format = FORMATS[fmt]
+        self.header = bytes(self.mm[PAGE.size:PAGE.size + header_size])
+        self.lost = 0
+
+    def head(self):
+        return struct.unpack_from('=Q', self.mm, HEAD)[0]
+
+    def read(self, n):
+        """Record n, or None if it was overwritten (or is being written)"""
+        off = self.slots_offset + (n % self.nslots) * self.slot_size
+        seq, length, _ = SLOT.unpack_from(self.mm, off)
+        if seq != n:
+            return None
+        rec = self.mm[off + SLOT.size:off + SLOT.size + length]
+        if struct.unpack_from('=Q', self.mm, off)[0] != n:
+            return None
+        return rec
+
+    def records(self, start=None, poll_s=0.001):
+        """Records from start (default: the next one published), forever"""
+        n = self.head() if start is None else start
+        while True:
+            head = self.head()
+            if n >= head:
+                time.sleep(poll_s)
+                continue
+            if head - n > self.nslots:
+                self.lost += head - self.nslots - n
+                n = head - self.nslots
+            rec = self.read(n)
+            if rec is None:
+                self.lost += 1
+            else:
+                yield rec
+            n += 1
+
+
+def main(argv):
+    if len(argv) < 2:
+        print('usage: scfeed.py name [--all]', file=sys.stderr)
+        return 2
+    feed = Feed(argv[1])
+    start = max(0, feed.head() - feed.nslots) if '--all' in argv[2:] else None
+    out = sys.stdout.buffer
+    out.write(feed.header)
+    try:
+        for rec in feed.records(start):
+            out.write(rec)
+            out.flush()
+    finally:
+        if feed.lost:
+            print(f'scfeed: {feed.lost} records lost', file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main(sys.argv))
+    except (KeyboardInterrupt, BrokenPipeError):
+        sys.exit(0)
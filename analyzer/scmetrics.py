@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+scmetrics.py
+
+Reader for the clients' shared-memory metrics page (-M ...,shm=name,
+layout in sigclient/metrics.h).
+
+    import scmetrics
+    page = scmetrics.Page('sigclient')   # /dev/shm/sigclient
+    for loop in page.snapshot():
+        loop.ticks, loop.hist['late'].quantile(0.99)
+        for s in loop.streams:
+            s.name, s.bytes, s.samples, s.absent, s.reads, s.inbuf, s.rtt_us
+
+Each loop's section is copied under its seqlock (retried while the loop
+rewrites it), so reading never blocks or slows the clients.
+
+    scmetrics.py name [interval_s]    print rates and quantiles, repeating
+"""
+
+import mmap
+import os
+import struct
+import sys
+import time
+
+MAGIC = b'SCM1'
+VERSION = 3
+SUB_BITS = 3
+BUCKETS = (40 + 1) << SUB_BITS
+KINDS = ('late', 'parse', 'format', 'flush')
+
+PAGE = struct.Struct('=4sIIIqq')
+SECTION = struct.Struct('=QqII')
+LOOP = struct.Struct('=QQQQ')
+HIST = struct.Struct(f'=QQQ{BUCKETS}I')
+STREAM = struct.Struct('=32s11Q')
+
+
+def bucket_lower(i):
+    if i < (1 << SUB_BITS):
+        return i
+    shift = (i >> SUB_BITS) - 1
+    return ((1 << SUB_BITS) + (i & ((1 << SUB_BITS) - 1))) << shift
+
+
+class Hist:
+    def __init__(self, fields):
+        self.count, self.sum_ns, self.max_ns = fields[:3]
+        self.buckets = fields[3:]
+
+    def mean_ns(self):
+        return self.sum_ns / self.count if self.count else 0.0
+
+    def quantile(self, q):
+        """Lower bound (ns) of the bucket holding quantile q"""
+        if not self.count:
+            return 0
+        want, seen = max(1, int(q * self.count + 0.5)), 0
+        for i, n in enumerate(self.buckets):
+            seen += n
+            if seen >= want:
+                return bucket_lower(i)
+        return self.max_ns
+
+
+class Stream:
+    def __init__(self, fields):
+        (name, self.bytes, self.samples, self.windows, self.absent, self.connects, self.drops,
+         self.reads, self.truncated, self.inbuf, self.rtt_us, self.rttvar_us) = fields
+        self.name = name.split(b'\0', 1)[0].decode()
+
+
+class Loop:
+    def __init__(self, index, raw):
+        self.index = index
+        _, self.snapshot_ns, self.first, n = SECTION.unpack_from(raw)
+        off = SECTION.size
+        self.ticks, self.skipped, self.wakeups, self.events = LOOP.unpack_from(raw, off)
+        off += LOOP.size
+        self.hist = {}
+        for kind in KINDS:
+            self.hist[kind] = Hist(HIST.unpack_from(raw, off))
+            off += HIST.size
+        self.streams = [Stream(STREAM.unpack_from(raw, off + k * STREAM.size)) for k in range(n)]
+
+
+class Page:
+    def __init__(self, name):
+        path = os.path.join('/dev/shm', name.lstrip('/'))
+        with open(path, 'rb') as f:
+            self.mm = mmap.mmap(f.fileno(), 0, prot=mmap.PROT_READ)
+        magic, version, self.nloops, self.section_size, self.interval_ns, self.start_ns = PAGE.unpack_from(self.mm)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f'{path}: not a metrics page (version {VERSION})')
+
+    def section(self, k):
+        off = PAGE.size + k * self.section_size
+        while True:
+            seq = struct.unpack_from('=Q', self.mm, off)[0]
+            if seq & 1:
+                time.sleep(0)
+                continue
+            raw = self.mm[off:off + self.section_size]
+            if struct.unpack_from('=Q', self.mm, off)[0] == seq:
+                return Loop(k, raw)
+
+    def snapshot(self):
+        return [self.section(k) for k in range(self.nloops)]
+
+
+def main(argv):
+    if len(argv) < 2:
+        print('usage: scmetrics.py name [interval_s]', file=sys.stderr)
+        return 2
+    page = Page(argv[1])
+    interval = float(argv[2]) if len(argv) > 2 else page.interval_ns / 1e9
+    prev = {}
+    while True:
+        for loop in page.snapshot():
+            quant = ', '.join(f'{k} p50 {h.quantile(0.5) / 1e3:.1f} p99 {h.quantile(0.99) / 1e3:.1f} us'
+                              for k, h in loop.hist.items() if h.count)
+            print(f'loop {loop.index}: {loop.ticks} ticks ({loop.skipped} skipped), {loop.events} events; {quant}')
+            for s in loop.streams:
+                p, dt = prev.get(s.name, (None, 0))
+                if p and loop.snapshot_ns > dt:
+                    secs = (loop.snapshot_ns - dt) / 1e9
+                    rate = (f'{(s.bytes - p.bytes) / secs:.0f} B/s, {(s.samples - p.samples) / secs:.1f} samples/s, '
+                            f'{(s.reads - p.reads) / secs:.1f} reads/s, ')
+                else:
+                    rate = ''
+                print(f'  {s.name}: {rate}{s.absent} of {s.windows} windows absent, '
+                      f'{s.connects} connects, {s.drops} drops, {s.inbuf} B buffer, {s.truncated} truncated, '
+                      f'rtt us {s.rtt_us} +- {s.rttvar_us}')
+                prev[s.name] = (s, loop.snapshot_ns)
+        sys.stdout.flush()
+        time.sleep(interval)
+
+
+if __name__ == '__main__':
+    try:
+        sys.exit(main(sys.argv))
+    except KeyboardInterrupt:
+        sys.exit(0)
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+e2e.py
+
+End-to-end benchmark: runs bench/mockserver at a chosen load, drives
+client2 against it for a while and prints one JSON object with the
+results (make bench):
+
+    throughput      samples/s and bytes/s the client received
+    cpu_ns_per_sample   client process CPU time (user + sys) per sample
+    tick_late_us    tick lateness quantiles of the tick loop (-M)
+    control_rtt_us  control round trips per target (p50/p99/max)
+    server          the mock server's own totals
+
+    e2e.py [--rate N] [--ports N] [--line BYTES] [--burst N]
+           [--seconds S] [--format json|bin] [--client ./client2]
+           [-- client args...]
+
+The client writes its records to /dev/null in --format, JSON by default
+like the clients themselves, so the encoder and flush path are part of
+what is measured; -F needs JSON.
+"""
+
+import argparse
+import json
+import os
+import re
+import signal
+import subprocess
+import sys
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(HERE)
+
+METRICS_LOOP = re.compile(r'^sigclient: metrics loop (\d+): (\d+) ticks \((\d+) skipped\).*?late us p50 ([\d.]+) p99 ([\d.]+) max ([\d.]+)')
+METRICS_STREAM = re.compile(r'^sigclient: metrics (\S+): .* (\d+) of (\d+) windows absent')
+RTT = re.compile(r'^client2: (\d+:\d+): (\d+) acked, (\d+) retries, (\d+) lost.*rtt us min ([\d.]+) mean ([\d.]+) max ([\d.]+) p50 ([\d.]+) p99 ([\d.]+)')
+
+
+def parse_client(stderr):
+    out = {'tick_late_us': None, 'control_rtt_us': {}, 'absent_windows': {}}
+    for line in stderr.splitlines():
+        m = METRICS_LOOP.match(line)
+        if m and m.group(1) == '0':
+            # the last snapshot, taken at exit, covers the whole run
+            out['ticks'] = int(m.group(2))
+            out['skipped'] = int(m.group(3))
+            out['tick_late_us'] = {'p50': float(m.group(4)), 'p99': float(m.group(5)), 'max': float(m.group(6))}
+            continue
+        m = METRICS_STREAM.match(line)
+        if m:
+            prev = out['absent_windows'].get(m.group(1), [0, 0])
+            out['absent_windows'][m.group(1)] = [prev[0] + int(m.group(2)), prev[1] + int(m.group(3))]
+            continue
+        m = RTT.match(line)
+        if m:
+            out['control_rtt_us'][m.group(1)] = {
+                'acked': int(m.group(2)), 'retries': int(m.group(3)), 'lost': int(m.group(4)),
+                'min': float(m.group(5)), 'mean': float(m.group(6)), 'max': float(m.group(7)),
+                'p50': float(m.group(8)), 'p99': float(m.group(9)),
+            }
+    return out
+
+
+def main(argv):
+    ap = argparse.ArgumentParser(description='client2 end-to-end benchmark')
+    ap.add_argument('--rate', type=float, default=2000, help='lines/s per port')
+    ap.add_argument('--ports', type=int, default=3)
+    ap.add_argument('--line', type=int, default=6, help='line length in bytes, CRLF included')
+    ap.add_argument('--burst', type=int, default=1, help='lines per server write')
+    ap.add_argument('--seconds', type=float, default=5)
+    ap.add_argument('--format', choices=('json', 'bin'), default='json', help='client output format (-o)')
+    ap.add_argument('--server', default=os.path.join(HERE, 'mockserver'))
+    ap.add_argument('--client', default=os.path.join(ROOT, 'client2'))
+    ap.add_argument('client_args', nargs='*', help='extra client arguments (after --)')
+    args = ap.parse_args(argv[1:])
+
+    server = subprocess.Popen([args.server, '-n', str(args.ports), '-r', str(args.rate), '-l', str(args.line),
+                               '-b', str(args.burst), '-d', str(args.seconds + 2)],
+                              stdout=subprocess.PIPE, text=True)
+    time.sleep(0.3)
+    streams = []
+    for k in range(args.ports):
+        streams += ['-s', f'out{k + 1}={4001 + k}']
+    cmd = [args.client, '-M', '1s', '-o', args.format] + streams + args.client_args
+    client = None
+    try:
+        with open(os.devnull, 'wb') as devnull:
+            client = subprocess.Popen(cmd, stdout=devnull, stderr=subprocess.PIPE, text=True)
+            start = time.monotonic()
+            time.sleep(args.seconds)
+            usage = None
+            if client.poll() is None:
+                client.send_signal(signal.SIGINT)
+                stderr = client.stderr.read()
+                _, status, usage = os.wait4(client.pid, 0)
+                client_exit = os.waitstatus_to_exitcode(status)
+            else:
+                # exited early (bad arguments, lost connection): no rusage left to collect
+                stderr = client.stderr.read()
+                client_exit = client.returncode
+            wall = time.monotonic() - start
+    finally:
+        if client is not None and client.poll() is None:
+            client.kill()
+            client.wait()
+        server.send_signal(signal.SIGINT)
+        server_out, _ = server.communicate()
+    totals = json.loads(server_out.strip().splitlines()[-1])
+
+    # only what the server wrote reached the client: not lines dropped for a
+    # full queue, nor lines still queued at exit
+    samples = totals['bytes'] // args.line
+    cpu = usage.ru_utime + usage.ru_stime if usage else None
+    result = {
+        'config': {'rate': args.rate, 'ports': args.ports, 'line': args.line, 'burst': args.burst,
+                   'seconds': args.seconds, 'format': args.format, 'client': cmd[1:]},
+        'throughput': {'samples_per_s': samples / wall, 'bytes_per_s': totals['bytes'] / wall},
+        'cpu_ns_per_sample': cpu * 1e9 / samples if cpu is not None and samples else None,
+        'cpu_share': cpu / wall if cpu is not None else None,
+        'client_exit': client_exit,
+        'server': totals,
+    }
+    result.update(parse_client(stderr))
+    if client_exit != 0:
+        sys.stderr.write(stderr)
+    json.dump(result, sys.stdout, indent=2)
+    print()
+    return 0 if result['client_exit'] == 0 else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,497 @@
+// kernel_bench.c
+// Microbenchmarks for the hot kernels of the ingest core, isolated from
+// the sockets:
+//
+//   tokenize  sc_conn_reserve + sc_conn_feed per received chunk (what
+//             follows each recv), over recorded values, CRLF split across
+//             chunks, long lines and whole 2048-byte buffers
+//   trim      sc_trim on padded and clean tokens
+//   parse     sc_parse_double against strtod
+//   format    sc_client_output's JSON encoder against the snprintf line
+//             it replaced
+//
+// Recorded data is the values of JSON capture files given as arguments
+// (e.g. out.json out2.json); without any, synthetic samples are used.
+// Each case runs RUNS times with the iteration count calibrated to about
+// RUN_NS; the median and the best run are reported, with the spread
+// (interquartile range over median), one line per case:
+// "name median_ns min_ns spread%".
+//
+// -c instead checks that sc_parse_double agrees with strtod, bit for bit
+// and in the characters consumed, on the recorded values, on edge cases
+// and on random decimals (make check); exits 1 on any difference.
+//
+// -b baseline compares against an earlier output and exits 1 if any case
+// got slower by more than -t percent (default 10), so a change to the
+// core can be gated on it. The comparison uses the best run, which
+// interference on a shared host can only make slower, not faster.
+//
+// usage: kernel_bench [-c] [-b baseline] [-t percent] [capture.json...]
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../sigclient/sigclient.h"
+#include "../sigclient/scan.h"
+
+#define RUNS 15
+#define RUN_NS 10e6
+#define STREAM_MIN (256 << 10)  // bytes of sample text per data set
+#define MAX_CASES 64
+#define MAX_CHUNKS 65536
+
+static volatile double sink;
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// A data set: sample text cut into the chunks that the reads deliver
+struct data {
+	char *text;
+	size_t len;
+	size_t cuts[MAX_CHUNKS + 1];    // chunk k is text[cuts[k], cuts[k + 1])
+	int nchunks;
+};
+
+struct result {
+	char name[64];
+	double median, min, spread;
+};
+
+static struct result results[MAX_CASES];
+static int nresults;
+
+static int cmp_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Time fn(arg, iters) (which performs iters operations) and record ns/op
+static void run_case(const char *name, void (*fn)(void *, long), void *arg) {
+	long iters = 1;
+	for (;;) {
+		double t0 = now_ns();
+		fn(arg, iters);
+		double dt = now_ns() - t0;
+		if (dt >= RUN_NS / 4 || iters > (1L << 40)) {
+			iters = (long)(iters * (RUN_NS / (dt > 1 ? dt : 1))) + 1;
+			break;
+		}
+		iters *= 4;
+	}
+	double t[RUNS];
+	for (int r = 0; r < RUNS; ++r) {
+		double t0 = now_ns();
+		fn(arg, iters);
+		t[r] = (now_ns() - t0) / (double)iters;
+	}
+	qsort(t, RUNS, sizeof(t[0]), cmp_double);
+	struct result *res = &results[nresults++];
+	snprintf(res->name, sizeof(res->name), "%s", name);
+	res->median = t[RUNS / 2];
+	res->min = t[0];
+	res->spread = 100.0 * (t[RUNS * 3 / 4] - t[RUNS / 4]) / res->median;
+	printf("%-32s %10.1f %10.1f %6.1f%%\n", res->name, res->median, res->min, res->spread);
+	fflush(stdout);
+}
+
+// ---- data sets ----
+
+static void append(struct data *d, size_t *cap, const char *s, size_t n) {
+	if (d->len + n + 1 > *cap) {
+		*cap = (*cap + n) * 2;
+		d->text = realloc(d->text, *cap);
+		if (!d->text) exit(1);
+	}
+	memcpy(d->text + d->len, s, n);
+	d->len += n;
+	d->text[d->len] = '\0';
+}
+
+// Every quoted stream value ("out1": "-3.4") of the capture files as a
+// "-3.4\r\n" line, repeated to STREAM_MIN bytes
+static int load_captures(struct data *d, char **paths, int npaths) {
+	size_t cap = 0;
+	char *vals = NULL;
+	size_t vlen = 0, vcap = 0;
+	for (int i = 0; i < npaths; ++i) {
+		FILE *f = fopen(paths[i], "r");
+		if (!f) {
+			perror(paths[i]);
+			continue;
+		}
+		char line[1024];
+		while (fgets(line, sizeof(line), f)) {
+			for (char *p = strstr(line, "\": \""); p; p = strstr(p, "\": \"")) {
+				p += 4;
+				char *e = strchr(p, '"');
+				if (!e) break;
+				if (e - p > 0 && strncmp(p, "--", 2) != 0) {
+					if (vlen + (size_t)(e - p) + 3 > vcap) {
+						vcap = (vcap + (size_t)(e - p) + 3) * 2;
+						vals = realloc(vals, vcap);
+						if (!vals) exit(1);
+					}
+					memcpy(vals + vlen, p, (size_t)(e - p));
+					vlen += (size_t)(e - p);
+					memcpy(vals + vlen, "\r\n", 2);
+					vlen += 2;
+				}
+				p = e + 1;
+			}
+		}
+		fclose(f);
+	}
+	if (vlen == 0) {
+		free(vals);
+		return -1;
+	}
+	while (d->len < STREAM_MIN) append(d, &cap, vals, vlen);
+	free(vals);
+	return 0;
+}
+
+static void synth_samples(struct data *d) {
+	size_t cap = 0;
+	char line[32];
+	srand(1);
+	while (d->len < STREAM_MIN) {
+		int n = snprintf(line, sizeof(line), "%.1f\r\n", (rand() % 100 - 50) / 10.0);
+		append(d, &cap, line, (size_t)n);
+	}
+}
+
+static void long_lines(struct data *d) {
+	size_t cap = 0;
+	char line[SC_TOKEN_MAX];
+	memset(line, '7', sizeof(line));
+	line[0] = '-';
+	line[1] = '0';
+	line[2] = '.';
+	memcpy(line + SC_TOKEN_MAX - 34, "\r\n", 2);     // 478-byte values
+	while (d->len < STREAM_MIN) append(d, &cap, line, SC_TOKEN_MAX - 32);
+}
+
+static struct data *copy_text(const struct data *from) {
+	struct data *d = calloc(1, sizeof(*d));
+	if (!d) exit(1);
+	d->text = malloc(from->len + 1);
+	if (!d->text) exit(1);
+	memcpy(d->text, from->text, from->len + 1);
+	d->len = from->len;
+	return d;
+}
+
+// Fixed-size chunks
+static void cut_every(struct data *d, size_t size) {
+	d->nchunks = 0;
+	for (size_t off = 0; off < d->len && d->nchunks < MAX_CHUNKS; off += size) d->cuts[d->nchunks++] = off;
+	d->cuts[d->nchunks] = d->nchunks < MAX_CHUNKS ? d->len : d->cuts[d->nchunks - 1] + size;
+}
+
+// Chunks of about size that end between '\r' and '\n'
+static void cut_crlf(struct data *d, size_t size) {
+	d->nchunks = 0;
+	size_t off = 0;
+	while (off < d->len && d->nchunks < MAX_CHUNKS) {
+		d->cuts[d->nchunks++] = off;
+		size_t end = off + size < d->len ? off + size : d->len;
+		char *cr = memchr(d->text + end, '\r', d->len - end);
+		off = cr ? (size_t)(cr - d->text) + 1 : d->len;
+	}
+	d->cuts[d->nchunks] = off;
+}
+
+// ---- kernels ----
+
+struct tokenize_arg {
+	const struct data *d;
+	int numeric;
+	int stats;
+};
+
+static void bench_tokenize(void *p, long iters) {
+	const struct tokenize_arg *a = p;
+	static char inbuf[SC_BUF_MAX];   // room to grow, as in the client's slab
+	struct sc_conn c;
+	struct sc_stream s;
+	struct sc_stats st;
+	memset(&c, 0, sizeof(c));
+	sc_conn_init(&c, &s, inbuf);
+	c.numeric = a->numeric;
+	if (a->stats) {
+		sc_stats_reset(&st);
+		c.stats = &st;
+	}
+	c.state = SC_CONN_UP;
+	const struct data *d = a->d;
+	for (long i = 0; i < iters; ++i) {
+		int k = (int)(i % d->nchunks);
+		size_t n = d->cuts[k + 1] - d->cuts[k];
+		int room = sc_conn_reserve(&c);
+		if ((size_t)room < n) n = (size_t)room;
+		memcpy(c.inbuf + c.inlen, d->text + d->cuts[k], n);
+		sc_conn_feed(&c, n);
+		if ((i & 15) == 15) {
+			// window boundary
+			sink += c.have ? c.value : 0;
+			c.have = 0;
+			if (a->stats) sc_stats_reset(&st);
+		}
+	}
+}
+
+struct tokens {
+	char (*tok)[32];
+	int n;
+};
+
+static void bench_trim(void *p, long iters) {
+	const struct tokens *t = p;
+	char buf[32];
+	for (long i = 0; i < iters; ++i) {
+		memcpy(buf, t->tok[i % t->n], sizeof(buf));
+		sc_trim(buf);
+		sink += buf[0];
+	}
+}
+
+static void bench_parse_sc(void *p, long iters) {
+	const struct tokens *t = p;
+	for (long i = 0; i < iters; ++i) {
+		const char *s = t->tok[i % t->n];
+		double v;
+		sc_parse_double(s, strlen(s), &v);
+		sink += v;
+	}
+}
+
+static void bench_parse_strtod(void *p, long iters) {
+	const struct tokens *t = p;
+	for (long i = 0; i < iters; ++i) sink += strtod(t->tok[i % t->n], NULL);
+}
+
+static void bench_format(void *p, long iters) {
+	struct sc_client *c = p;
+	long long ts = 1765241193600000000LL;
+	for (long i = 0; i < iters; ++i) sc_client_output(c, ts += 100000000LL);
+}
+
+// The pre-encoder JSON line: one snprintf of the whole record
+static void bench_format_printf(void *p, long iters) {
+	struct sc_client *c = p;
+	static char line[4096];
+	long long ts = 1765241193600LL;
+	for (long i = 0; i < iters; ++i) {
+		int n = snprintf(line, sizeof(line), "{\"timestamp\": %lld, \"out1\": \"%s\", \"out2\": \"%s\", \"out3\": \"%s\"}\n",
+			ts += 100, sc_client_value(c, 0), sc_client_value(c, 1), sc_client_value(c, 2));
+		sink += n;
+	}
+}
+
+// ---- -c ----
+
+static const char *const parse_edges[] = {
+	"", "+", "-", ".", "-.", "0", "-0", "+0.0", "5", "-6.2", "4.95", "-.5", "5.", "007.50",
+	" 5", "\t-3.4", "  +1", "5 ", "-3.4  ", "1.2.3", "- 5", "--5", "+-5", "abc", "1x",
+	"1234567890123456", "12345678901234567", "1234567890123456789", "12345678901234567890123",
+	"0.1234567890123456789", "9007199254740992", "9007199254740993", "18446744073709551615",
+	"0.000000000000000000000000000001", "00000000000000000000000000001.5",
+	"1e5", "1E-5", "1e+22", "1e22", "1e23", "-1e-22", "1e-23", "4.5e15", "1e308", "1e309", "-1e400",
+	"1e-324", "4.9e-324", "2.2250738585072014e-308", "1.7976931348623157e308", "1e99999999",
+	"1e", "1e+", "1e-x", "1E", "5e-0",
+	"nan", "NaN", "-nan", "inf", "-Infinity", "+INF",
+};
+
+// strtod on a NUL-terminated copy of s[0..len) against sc_parse_double
+static int check_parse_one(const char *s, size_t len) {
+	static char tmp[SC_TOKEN_MAX + 1];
+	memcpy(tmp, s, len);
+	tmp[len] = '\0';
+	char *end;
+	double want = strtod(tmp, &end), got;
+	size_t want_n = (size_t)(end - tmp), got_n = sc_parse_double(s, len, &got);
+	if (want_n == 0 ? got_n == 0 && isnan(got) : got_n == want_n && memcmp(&got, &want, sizeof(got)) == 0)
+		return 0;
+	fprintf(stderr, "kernel_bench: \"%.*s\": sc_parse_double %.17g (%zu chars), strtod %.17g (%zu chars)\n",
+		(int)(len < 80 ? len : 80), s, got, got_n, want, want_n);
+	return -1;
+}
+
+static int check_parse(const struct data *rec) {
+	long cases = 0;
+	int bad = 0;
+	for (const char *p = rec->text, *e; (e = strchr(p, '\r')) != NULL && cases < 100000; p = e + 2, ++cases)
+		bad |= check_parse_one(p, (size_t)(e - p));
+	for (size_t i = 0; i < sizeof(parse_edges) / sizeof(parse_edges[0]); ++i, ++cases)
+		bad |= check_parse_one(parse_edges[i], strlen(parse_edges[i]));
+
+	// long values up to SC_TOKEN_MAX: the exponent at the end must count
+	static char lng[SC_TOKEN_MAX];
+	for (size_t len = 60; len < sizeof(lng); len += 7, ++cases) {
+		memset(lng, '3', len);
+		lng[1] = '.';
+		memcpy(lng + len - 2, "e5", 2);
+		bad |= check_parse_one(lng, len);
+	}
+
+	// random doubles at every precision, and random digit strings
+	char buf[64];
+	srand(1);
+	for (int i = 0; i < 200000; ++i, cases += 2) {
+		uint64_t bits = (uint64_t)rand() << 42 ^ (uint64_t)rand() << 21 ^ (uint64_t)rand();
+		double v;
+		memcpy(&v, &bits, sizeof(v));
+		int n = snprintf(buf, sizeof(buf), i & 1 ? "%.*e" : "%.*g", 1 + i % 17, isfinite(v) ? v : 1.5);
+		bad |= check_parse_one(buf, (size_t)n);
+		n = 0;
+		if (rand() % 2) buf[n++] = '-';
+		for (int d = 1 + rand() % 24, dot = rand() % 26; d > 0; --d, --dot) {
+			if (dot == 0) buf[n++] = '.';
+			buf[n++] = (char)('0' + rand() % 10);
+		}
+		if (rand() % 3 == 0) n += snprintf(buf + n, sizeof(buf) - (size_t)n, "e%d", rand() % 60 - 30);
+		bad |= check_parse_one(buf, (size_t)n);
+	}
+	printf("parse: %ld cases, %s\n", cases, bad ? "mismatches" : "sc_parse_double agrees with strtod");
+	return bad ? 1 : 0;
+}
+
+// Client with the default three streams, each holding a value, writing
+// to /dev/null; NULL if it cannot be set up
+static struct sc_client *format_client(int numeric, const char *const vals[3]) {
+	static struct sc_client clients[2];
+	struct sc_client *c = &clients[numeric];
+	struct sc_options opts;
+	char prog[] = "kernel_bench", *argv[] = { prog, NULL };
+	sc_options_init(&opts);
+	optind = 1;
+	if (sc_options_parse(&opts, 1, argv) < 0) return NULL;
+	opts.numeric = numeric;
+	opts.flush = SC_FLUSH_SIZE;
+	opts.flush_arg = 1 << 16;
+	int rc = sc_client_init(c, &opts, 100 * SC_NS_PER_MS);
+	sc_options_free(&opts);
+	if (rc < 0 || c->nconns < 3) return NULL;
+	close(c->out.fd == 1 ? -1 : c->out.fd);
+	c->out.fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	for (int i = 0; i < 3; ++i) {
+		struct sc_conn *conn = &c->conns[i];
+		size_t n = strlen(vals[i]);
+		memcpy(conn->inbuf, vals[i], n);
+		memcpy(conn->inbuf + n, "\r\n", 2);
+		sc_conn_feed(conn, n + 2);
+	}
+	return c;
+}
+
+// ---- baseline ----
+
+static int compare(const char *path, double pct) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	int worse = 0;
+	char name[64];
+	double median, min, spread;
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "%63s %lf %lf %lf", name, &median, &min, &spread) != 4) continue;
+		for (int i = 0; i < nresults; ++i) {
+			if (strcmp(results[i].name, name) != 0) continue;
+			double change = 100.0 * (results[i].min - min) / min;
+			if (change > pct) {
+				fprintf(stderr, "kernel_bench: %s: best %.1f ns -> %.1f ns (%+.1f%%)\n", name, min, results[i].min, change);
+				worse++;
+			}
+		}
+	}
+	fclose(f);
+	if (worse) fprintf(stderr, "kernel_bench: %d case(s) slower than %s by more than %.0f%%\n", worse, path, pct);
+	return worse ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+	const char *baseline = NULL;
+	double pct = 10;
+	int opt, check = 0;
+	while ((opt = getopt(argc, argv, "b:ct:h")) != -1) {
+		switch (opt) {
+		case 'c': check = 1; break;
+		case 'b': baseline = optarg; break;
+		case 't': pct = atof(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-c] [-b baseline] [-t percent] [capture.json...]\n", argv[0]);
+			return 2;
+		}
+	}
+	sc_scan_init();
+	int cpu = sc_cpu_nth(0);
+	if (cpu >= 0) sc_pin_thread(cpu);
+
+	struct data *rec = calloc(1, sizeof(*rec)), *lng = calloc(1, sizeof(*lng));
+	if (!rec || !lng) return 1;
+	const char *src = "captures";
+	if (load_captures(rec, argv + optind, argc - optind) < 0) {
+		synth_samples(rec);
+		src = "synthetic";
+	}
+	if (check) return check_parse(rec);
+	long_lines(lng);
+	struct data *split = copy_text(rec), *full = copy_text(rec);
+	cut_every(rec, 64);
+	cut_crlf(split, 64);
+	cut_every(full, SC_BUF_SIZE * 3 / 4);   // as much as one read takes
+	cut_every(lng, 1500);
+	fprintf(stderr, "kernel_bench: %s samples, scan %s, %d runs per case\n", src, sc_scan_impl(), RUNS);
+	printf("%-32s %10s %10s %7s\n", "# case (ns/op)", "median", "min", "spread");
+
+	struct tokenize_arg targs[] = {
+		{ rec, 0, 0 }, { rec, 1, 0 }, { rec, 1, 1 }, { split, 1, 0 }, { full, 1, 0 }, { full, 1, 1 }, { lng, 0, 0 },
+	};
+	const char *tnames[] = {
+		"tokenize/64B", "tokenize/64B/numeric", "tokenize/64B/stats", "tokenize/64B/crlf-split",
+		"tokenize/1536B/numeric", "tokenize/1536B/stats", "tokenize/long-lines",
+	};
+	for (size_t i = 0; i < sizeof(targs) / sizeof(targs[0]); ++i) run_case(tnames[i], bench_tokenize, &targs[i]);
+
+	// tokens: the recorded values, padded for trim
+	struct tokens clean = { calloc(4096, 32), 0 }, padded = { calloc(4096, 32), 0 };
+	if (!clean.tok || !padded.tok) return 1;
+	for (const char *p = rec->text; clean.n < 4096 && p < rec->text + rec->len;) {
+		const char *e = strchr(p, '\r');
+		if (!e || e - p > 24) break;
+		snprintf(clean.tok[clean.n], 32, "%.*s", (int)(e - p), p);
+		snprintf(padded.tok[padded.n], 32, " \t%.*s\r\n", (int)(e - p), p);
+		clean.n++;
+		padded.n++;
+		p = e + 2;
+	}
+	run_case("trim/padded", bench_trim, &padded);
+	run_case("trim/clean", bench_trim, &clean);
+	run_case("parse/sc_parse_double", bench_parse_sc, &clean);
+	run_case("parse/strtod", bench_parse_strtod, &clean);
+
+	static const char *const vals[3] = { "-4.9", "3.1", "5.0" };
+	struct sc_client *text = format_client(0, vals), *num = format_client(1, vals);
+	if (text && num) {
+		run_case("format/json", bench_format, text);
+		run_case("format/json/numeric", bench_format, num);
+		run_case("format/snprintf", bench_format_printf, text);
+	} else {
+		fprintf(stderr, "kernel_bench: skipping format cases (client setup failed)\n");
+	}
+	return baseline ? compare(baseline, pct) : 0;
+}
@@ -0,0 +1,286 @@
+// mockserver.c
+// Load generator standing in for the signal servers: N consecutive TCP
+// ports each stream newline-delimited samples ("-0003.4\r\n", a sine of
+// a different frequency per port) at a set rate, line length and burst
+// size to every connected client, and a UDP control endpoint stores
+// WRITEs and answers READs with the stored value, like the real server.
+//
+// Sends are paced against CLOCK_MONOTONIC and never block: a client
+// that stops reading has lines dropped (whole lines only) once its
+// buffer is full. On exit the totals are printed as one JSON object.
+//
+// usage: mockserver [-p port] [-n ports] [-r lines/s] [-l line bytes]
+//                   [-b burst] [-u control port, 0 = none] [-d seconds]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_PORTS 16
+#define MAX_CLIENTS 8       // per port
+#define OUT_CAP (64 << 10)  // per client, lines beyond it are dropped
+#define MAX_PROPS 64
+#define LINE_MAX 512
+
+struct client {
+	int fd;
+	char out[OUT_CAP];
+	size_t len;
+};
+
+struct port {
+	int listen_fd;
+	struct client clients[MAX_CLIENTS];
+	long long next_ns;
+	double phase;
+};
+
+struct prop {
+	uint16_t obj, prop, value;
+};
+
+static struct {
+	int base, nports, line_len, burst, ctl_port;
+	double rate, seconds;
+} cfg = { 4001, 3, 6, 1, 4000, 1000, 0 };
+
+// lines counts those queued to clients, dropped those that found a queue full
+static struct {
+	unsigned long long lines, bytes, dropped, accepts, reads, writes;
+} total;
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+	(void)sig;
+	stop = 1;
+}
+
+static long long mono_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int listen_on(int type, int port) {
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int one = 1;
+	if (fd < 0) return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || (type == SOCK_STREAM && listen(fd, 16) < 0)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void accept_all(struct port *p) {
+	int fd;
+	while ((fd = accept4(p->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		struct client *cl = NULL;
+		for (int i = 0; i < MAX_CLIENTS && !cl; ++i)
+			if (p->clients[i].fd < 0) cl = &p->clients[i];
+		if (!cl) {
+			close(fd);
+			continue;
+		}
+		cl->fd = fd;
+		cl->len = 0;
+		total.accepts++;
+	}
+}
+
+static void drop_client(struct client *cl) {
+	close(cl->fd);
+	cl->fd = -1;
+	cl->len = 0;
+}
+
+// Write what the socket takes; the rest stays buffered
+static void flush_client(struct client *cl) {
+	size_t off = 0;
+	while (off < cl->len) {
+		ssize_t w = send(cl->fd, cl->out + off, cl->len - off, MSG_NOSIGNAL);
+		if (w > 0) {
+			off += (size_t)w;
+			total.bytes += (unsigned long long)w;
+		} else if (w < 0 && errno == EINTR) {
+			continue;
+		} else if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		} else {
+			drop_client(cl);
+			return;
+		}
+	}
+	memmove(cl->out, cl->out + off, cl->len - off);
+	cl->len -= off;
+}
+
+// One burst of lines for every client of port k
+static void emit(struct port *p, int k) {
+	char lines[LINE_MAX * 64];
+	size_t n = 0;
+	int nlines = 0;
+	for (; nlines < cfg.burst && n + (size_t)cfg.line_len <= sizeof(lines); ++nlines) {
+		double v = 5 * sin(p->phase);
+		p->phase += 0.01 * (k + 1);
+		// zero padding keeps the line length fixed and the value a number
+		n += (size_t)sprintf(lines + n, "%0*.1f\r\n", cfg.line_len - 2, v);
+	}
+	for (int i = 0; i < MAX_CLIENTS; ++i) {
+		struct client *cl = &p->clients[i];
+		if (cl->fd < 0) continue;
+		if (cl->len + n > OUT_CAP) {
+			total.dropped += (unsigned long long)nlines;
+		} else {
+			memcpy(cl->out + cl->len, lines, n);
+			cl->len += n;
+			total.lines += (unsigned long long)nlines;
+		}
+		flush_client(cl);
+	}
+}
+
+// READ (op 1, obj, prop) -> (op 1, obj, prop, value); WRITE (op 2, obj,
+// prop, value) stores it. Unknown properties read as 1000.
+static void serve_control(int fd, struct prop *props, int *nprops) {
+	uint16_t m[4];
+	struct sockaddr_in from;
+	socklen_t fromlen = sizeof(from);
+	ssize_t r;
+	while ((r = recvfrom(fd, m, sizeof(m), 0, (struct sockaddr *)&from, &fromlen)) >= 6) {
+		uint16_t obj = ntohs(m[1]), pr = ntohs(m[2]);
+		struct prop *slot = NULL;
+		for (int i = 0; i < *nprops && !slot; ++i)
+			if (props[i].obj == obj && props[i].prop == pr) slot = &props[i];
+		if (ntohs(m[0]) == 2 && r == 8) {
+			if (!slot && *nprops < MAX_PROPS) {
+				slot = &props[(*nprops)++];
+				slot->obj = obj;
+				slot->prop = pr;
+			}
+			if (slot) slot->value = ntohs(m[3]);
+			total.writes++;
+		} else if (ntohs(m[0]) == 1) {
+			m[3] = htons(slot ? slot->value : 1000);
+			sendto(fd, m, sizeof(m), 0, (struct sockaddr *)&from, fromlen);
+			total.reads++;
+		}
+		fromlen = sizeof(from);
+	}
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-p port] [-n ports] [-r lines/s] [-l line bytes] [-b burst] [-u control port] [-d seconds]\n", prog);
+}
+
+int main(int argc, char **argv) {
+	int opt;
+	while ((opt = getopt(argc, argv, "p:n:r:l:b:u:d:h")) != -1) {
+		switch (opt) {
+		case 'p': cfg.base = atoi(optarg); break;
+		case 'n': cfg.nports = atoi(optarg); break;
+		case 'r': cfg.rate = atof(optarg); break;
+		case 'l': cfg.line_len = atoi(optarg); break;
+		case 'b': cfg.burst = atoi(optarg); break;
+		case 'u': cfg.ctl_port = atoi(optarg); break;
+		case 'd': cfg.seconds = atof(optarg); break;
+		default: usage(argv[0]); return 2;
+		}
+	}
+	if (cfg.nports < 1 || cfg.nports > MAX_PORTS || !(cfg.rate > 0) || cfg.line_len < 5 ||
+	    cfg.line_len > LINE_MAX || cfg.burst < 1 || cfg.burst > 64) {
+		usage(argv[0]);
+		return 2;
+	}
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	static struct port ports[MAX_PORTS];
+	struct pollfd pfds[MAX_PORTS + 1];
+	long long start = mono_ns(), period = (long long)(cfg.burst * 1e9 / cfg.rate);
+	for (int k = 0; k < cfg.nports; ++k) {
+		ports[k].listen_fd = listen_on(SOCK_STREAM, cfg.base + k);
+		if (ports[k].listen_fd < 0) {
+			fprintf(stderr, "mockserver: port %d: %s\n", cfg.base + k, strerror(errno));
+			return 1;
+		}
+		for (int i = 0; i < MAX_CLIENTS; ++i) ports[k].clients[i].fd = -1;
+		ports[k].next_ns = start + period;
+		pfds[k].fd = ports[k].listen_fd;
+		pfds[k].events = POLLIN;
+	}
+	int ctl = -1, npfds = cfg.nports;
+	if (cfg.ctl_port) {
+		ctl = listen_on(SOCK_DGRAM, cfg.ctl_port);
+		if (ctl < 0) {
+			fprintf(stderr, "mockserver: control port %d: %s\n", cfg.ctl_port, strerror(errno));
+			return 1;
+		}
+		pfds[npfds].fd = ctl;
+		pfds[npfds++].events = POLLIN;
+	}
+	struct prop props[MAX_PROPS];
+	int nprops = 0;
+
+	long long end = cfg.seconds > 0 ? start + (long long)(cfg.seconds * 1e9) : 0;
+	while (!stop && (!end || mono_ns() < end)) {
+		long long next = ports[0].next_ns;
+		for (int k = 1; k < cfg.nports; ++k)
+			if (ports[k].next_ns < next) next = ports[k].next_ns;
+		long long wait = next - mono_ns();
+		struct timespec ts = { 0, 0 };
+		if (wait > 0) {
+			ts.tv_sec = wait / 1000000000LL;
+			ts.tv_nsec = wait % 1000000000LL;
+		}
+		if (ppoll(pfds, (nfds_t)npfds, &ts, NULL) < 0 && errno != EINTR) {
+			perror("mockserver: ppoll");
+			return 1;
+		}
+		for (int k = 0; k < cfg.nports; ++k)
+			if (pfds[k].revents & POLLIN) accept_all(&ports[k]);
+		if (ctl >= 0 && (pfds[npfds - 1].revents & POLLIN)) serve_control(ctl, props, &nprops);
+
+		long long now = mono_ns();
+		for (int k = 0; k < cfg.nports; ++k) {
+			// behind by more than a second: skip ahead rather than flood
+			if (now - ports[k].next_ns > 1000000000LL) ports[k].next_ns = now;
+			while (ports[k].next_ns <= now) {
+				emit(&ports[k], k);
+				ports[k].next_ns += period;
+			}
+		}
+	}
+
+	double secs = (double)(mono_ns() - start) / 1e9;
+	printf("{\"seconds\": %.3f, \"lines\": %llu, \"bytes\": %llu, \"dropped_lines\": %llu, "
+		"\"accepts\": %llu, \"control_reads\": %llu, \"control_writes\": %llu}\n",
+		secs, total.lines, total.bytes, total.dropped, total.accepts, total.reads, total.writes);
+	return 0;
+}
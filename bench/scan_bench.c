@@ -0,0 +1,184 @@
+// scan_bench.c
+// Microbenchmark: delimiter scanning over one receive buffer
+// (SC_BUF_SIZE bytes) with the old strpbrk loop versus each scan.h
+// implementation available on this CPU. Reports the best of several runs.
+//
+// -c instead checks every available implementation against the scalar one
+// (make check): random buffers of every length up to two AVX2 blocks and
+// then some, at every alignment, with delimiters on the block edges, and
+// result arrays cut short. Exits 1 on the first disagreement.
+//
+// usage: scan_bench [-c] [iterations]
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../sigclient/sigclient.h"
+#include "../sigclient/scan.h"
+
+#define RUNS 5
+
+static volatile size_t sink;
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Lines like the signal servers send: "-3.4\r\n"
+static void fill_samples(char *buf, size_t len) {
+	size_t n = 0;
+	while (n < len) {
+		char line[32];
+		int l = snprintf(line, sizeof(line), "%.1f\r\n", (rand() % 100 - 50) / 10.0);
+		for (int i = 0; i < l && n < len; ++i) buf[n++] = line[i];
+	}
+}
+
+static void fill_long_lines(char *buf, size_t len) {
+	for (size_t i = 0; i < len; ++i) buf[i] = (i % 200 == 199) ? '\n' : '0' + (char)(i % 10);
+}
+
+static void fill_no_delims(char *buf, size_t len) {
+	for (size_t i = 0; i < len; ++i) buf[i] = '0' + (char)(i % 10);
+}
+
+// The pre-scan.h tokenizer loop: strpbrk from each line start
+static size_t run_strpbrk(const char *buf, size_t len) {
+	(void)len;
+	size_t n = 0;
+	const char *start = buf, *p;
+	while ((p = strpbrk(start, "\r\n")) != NULL) {
+		n++;
+		start = p + 1;
+	}
+	return n;
+}
+
+static uint32_t positions[SC_BUF_SIZE];
+
+static size_t run_delims(const char *buf, size_t len) {
+	return sc_scan_delims(buf, len, positions, SC_BUF_SIZE);
+}
+
+static size_t run_last(const char *buf, size_t len) {
+	return (size_t)sc_scan_last_delim(buf, len);
+}
+
+static double best_ns(size_t (*fn)(const char *, size_t), const char *buf, size_t len, long iters) {
+	double best = 1e30;
+	for (int r = 0; r < RUNS; ++r) {
+		double t0 = now_ns();
+		for (long i = 0; i < iters; ++i) sink += fn(buf, len);
+		double dt = (now_ns() - t0) / iters;
+		if (dt < best) best = dt;
+	}
+	return best;
+}
+
+static void report(const char *data, const char *impl, const char *op, double ns, size_t len) {
+	printf("%-12s %-8s %-8s %10.1f ns/buf %8.2f GB/s\n", data, impl, op, ns, len / ns);
+}
+
+// ---- -c ----
+
+#define CHECK_LEN 96        // three AVX2 blocks
+#define CHECK_ROUNDS 200
+
+static uint32_t want_pos[CHECK_LEN], got_pos[CHECK_LEN];
+
+// Compare impl with scalar on buf[0..len), max results at most
+static int check_one(const char *impl, const char *buf, size_t len, size_t max) {
+	sc_scan_select("scalar");
+	size_t want = sc_scan_delims(buf, len, want_pos, max);
+	long want_last = sc_scan_last_delim(buf, len);
+	sc_scan_select(impl);
+	size_t got = sc_scan_delims(buf, len, got_pos, max);
+	long got_last = sc_scan_last_delim(buf, len);
+
+	size_t bad = got != want ? 0 : want;
+	for (size_t i = 0; i < want && i < got; ++i) {
+		if (got_pos[i] != want_pos[i]) {
+			bad = i;
+			break;
+		}
+	}
+	if (got == want && bad == want && got_last == want_last) return 0;
+	fprintf(stderr, "%s: len %zu max %zu: ", impl, len, max);
+	if (got_last != want_last)
+		fprintf(stderr, "last %ld, scalar %ld\n", got_last, want_last);
+	else if (got != want)
+		fprintf(stderr, "%zu delimiters, scalar %zu\n", got, want);
+	else
+		fprintf(stderr, "delimiter %zu at %u, scalar %u\n", bad, got_pos[bad], want_pos[bad]);
+	return -1;
+}
+
+// Random bytes with about one delimiter in density, and some on block edges
+static void fill_random(char *buf, size_t len, int density) {
+	static const char other[] = "0123456789.-+e \t,";
+	for (size_t i = 0; i < len; ++i) {
+		int r = rand();
+		if (r % density == 0) buf[i] = (r / density) & 1 ? '\r' : '\n';
+		else if (r % 7 == 0) buf[i] = (char)(r >> 8);  // any byte, high bit included
+		else buf[i] = other[(r >> 4) % (sizeof(other) - 1)];
+	}
+	static const size_t edges[] = { 0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 95 };
+	for (size_t e = 0; e < sizeof(edges) / sizeof(edges[0]); ++e)
+		if (edges[e] < len && rand() % 2) buf[edges[e]] = rand() % 2 ? '\r' : '\n';
+}
+
+static int check(void) {
+	static char mem[CHECK_LEN + 32];
+	static const int densities[] = { 1, 3, 16, 1000000 };
+	long cases = 0;
+	srand(1);
+	for (const char *const *impl = sc_scan_available(); *impl; ++impl) {
+		for (int round = 0; round < CHECK_ROUNDS; ++round) {
+			// every alignment, so loads straddle the buffer start too
+			char *buf = mem + round % 32;
+			for (size_t len = 0; len <= CHECK_LEN; ++len) {
+				fill_random(buf, len, densities[round % 4]);
+				size_t maxes[] = { CHECK_LEN, len, len / 2, 1, 0 };
+				for (size_t m = 0; m < sizeof(maxes) / sizeof(maxes[0]); ++m, ++cases)
+					if (check_one(*impl, buf, len, maxes[m]) < 0) return 1;
+			}
+		}
+		printf("%-8s agrees with scalar\n", *impl);
+	}
+	printf("%ld cases\n", cases);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1 && strcmp(argv[1], "-c") == 0) return check();
+	long iters = argc > 1 ? atol(argv[1]) : 20000;
+	static char buf[SC_BUF_SIZE + 1];
+	size_t len = SC_BUF_SIZE;
+	struct {
+		const char *name;
+		void (*fill)(char *, size_t);
+	} sets[] = {
+		{ "samples", fill_samples },
+		{ "long-lines", fill_long_lines },
+		{ "no-delims", fill_no_delims },
+	};
+
+	srand(1);
+	printf("%-12s %-8s %-8s %17s %13s\n", "data", "impl", "op", "time", "throughput");
+	for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s) {
+		sets[s].fill(buf, len);
+		buf[len] = '\0';
+		report(sets[s].name, "strpbrk", "all", best_ns(run_strpbrk, buf, len, iters), len);
+		for (const char *const *impl = sc_scan_available(); *impl; ++impl) {
+			sc_scan_select(*impl);
+			report(sets[s].name, *impl, "all", best_ns(run_delims, buf, len, iters), len);
+			report(sets[s].name, *impl, "last", best_ns(run_last, buf, len, iters), len);
+		}
+	}
+	return 0;
+}
@@ -1,241 +1,32 @@
 // client1.c
-// Connects to localhost:4001,4002,4003 and prints a JSON line every 100ms
-// containing the most recent value per port (or "--" when none in the window).
+// Connects to localhost:4001,4002,4003 (or the streams given with -s/-c) and
+// prints a JSON line every 100ms containing the most recent value per stream
+// (or "--" when none in the window).
 
-#define _POSIX_C_SOURCE 199309L
 #include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <time.h>
-#include <sys/time.h>
-#include <poll.h>
 
-#define MAX_PORT 3
-#define BUF_SIZE 2048
-#define TOKEN_MAX 512
+#include "sigclient/sigclient.h"
 
-struct conn {
-	int port;
-	int fd;
-	char inbuf[BUF_SIZE];
-	int inlen;
-	char latest[TOKEN_MAX];
-	int have;
-	time_t last_connect_try;
-};
+#define WINDOW_MS 100   // default, -w overrides
 
-static long long epoch_ms_now(void) {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return (long long)tv.tv_sec * 1000LL + (tv.tv_usec / 1000LL);
+static void on_tick(struct sc_client *c, long long ts_ns, void *arg) {
+	(void)arg;
+	sc_client_output(c, ts_ns);
 }
 
-static int set_nonblocking(int fd) {
-	int flags = fcntl(fd, F_GETFL, 0);
-	if (flags == -1) return -1;
-	if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) return -1;
-	return 0;
-}
-
-static int connect_to_port(int port) {
-	int fd = socket(AF_INET, SOCK_STREAM, 0);
-	if (fd < 0) return -1;
-	struct sockaddr_in addr;
-	memset(&addr, 0, sizeof(addr));
-	addr.sin_family = AF_INET;
-	addr.sin_port = htons(port);
-	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
-	// blocking connect with small timeout handled by nonblocking + poll would be better,
-	// but we'll try a normal connect then set non-blocking for reads.
-	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-		close(fd);
-		return -1;
-	}
-	if (set_nonblocking(fd) < 0) {
-		close(fd);
-		return -1;
-	}
-	return fd;
-}
+int main(int argc, char **argv) {
+	struct sc_options opts;
+	sc_options_init(&opts);
+	if (sc_options_parse(&opts, argc, argv) < 0) return 2;
 
-// Trim leading/trailing whitespace
-static void trim(char *s) {
-	int i = 0, j = strlen(s) - 1;
-	while (i <= j && (s[i] == '\n' || s[i] == '\r' || s[i] == ' ' || s[i] == '\t')) i++;
-	while (j >= i && (s[j] == '\n' || s[j] == '\r' || s[j] == ' ' || s[j] == '\t')) j--;
-	if (i == 0 && j == (int)strlen(s) - 1) return;
-	if (i > j) { s[0] = '\0'; return; }
-	memmove(s, s + i, j - i + 1);
-	s[j - i + 1] = '\0';
-}
-
-int main(void) {
-	struct conn conns[MAX_PORT];
-	int ports[MAX_PORT] = {4001, 4002, 4003};
-	for (int i = 0; i < MAX_PORT; ++i) {
-		conns[i].port = ports[i];
-		conns[i].fd = -1;
-		conns[i].inlen = 0;
-		conns[i].latest[0] = '\0';
-		conns[i].have = 0;
-		conns[i].last_connect_try = 0;
+	struct sc_client client;
+	if (sc_client_init(&client, &opts, WINDOW_MS * SC_NS_PER_MS) < 0) {
+		perror("sc_client_init");
+		return 1;
 	}
-
-	// Determine first next tick (align to next 100ms)
-	long long now_ms = epoch_ms_now();
-	long long next_tick = now_ms + (100 - (now_ms % 100));
-
-	while (1) {
-		// Attempt connects for disconnected sockets (once per second)
-		long long now_try = epoch_ms_now();
-		for (int i = 0; i < MAX_PORT; ++i) {
-			if (conns[i].fd < 0) {
-				if (now_try - (long long)conns[i].last_connect_try >= 1000) {
-					conns[i].last_connect_try = now_try;
-					int fd = connect_to_port(conns[i].port);
-					if (fd >= 0) {
-						conns[i].fd = fd;
-						conns[i].inlen = 0;
-						conns[i].have = 0;
-						conns[i].latest[0] = '\0';
-					}
-				}
-			}
-		}
-
-		// Setup poll
-		int nfds = 0;
-		struct pollfd pfds[MAX_PORT];
-		for (int i = 0; i < MAX_PORT; ++i) {
-			if (conns[i].fd >= 0) {
-				pfds[nfds].fd = conns[i].fd;
-				pfds[nfds].events = POLLIN | POLLHUP | POLLERR;
-				pfds[nfds].revents = 0;
-				nfds++;
-			}
-		}
-
-		long long now = epoch_ms_now();
-		long long timeout = next_tick - now;
-		if (timeout < 0) timeout = 0;
-		if (timeout > 1000) timeout = 1000; // safety
-
-		int poll_res = 0;
-		if (nfds > 0) {
-			poll_res = poll(pfds, nfds, (int)timeout);
-		} else {
-			// no fds: just sleep until next tick
-			struct timespec ts;
-			ts.tv_sec = timeout / 1000;
-			ts.tv_nsec = (timeout % 1000) * 1000000;
-			nanosleep(&ts, NULL);
-		}
-
-		// If poll returned >0, read available data
-		if (poll_res > 0) {
-			int idx = 0;
-			for (int i = 0; i < MAX_PORT; ++i) {
-				if (conns[i].fd < 0) continue;
-				struct pollfd *p = &pfds[idx++];
-				if (p->revents & POLLIN) {
-					// read repeatedly until EAGAIN
-					while (1) {
-						ssize_t r = recv(conns[i].fd, conns[i].inbuf + conns[i].inlen, sizeof(conns[i].inbuf) - conns[i].inlen - 1, 0);
-						if (r > 0) {
-							conns[i].inlen += r;
-							conns[i].inbuf[conns[i].inlen] = '\0';
-							// extract tokens terminated by '\n' or '\r'
-							char *start = conns[i].inbuf;
-							char *pnl;
-							while ((pnl = strpbrk(start, "\r\n")) != NULL) {
-								size_t len = pnl - start;
-								char token[TOKEN_MAX];
-								if (len >= sizeof(token)) len = sizeof(token) - 1;
-								memcpy(token, start, len);
-								token[len] = '\0';
-								trim(token);
-								if (token[0] != '\0') {
-									size_t clen = strlen(token);
-									if (clen > sizeof(conns[i].latest) - 1) clen = sizeof(conns[i].latest) - 1;
-									memcpy(conns[i].latest, token, clen);
-									conns[i].latest[clen] = '\0';
-									conns[i].have = 1;
-								}
-								// move past the delimiter(s)
-								start = pnl + 1;
-							}
-							// move remaining partial token to beginning
-							int remain = conns[i].inlen - (start - conns[i].inbuf);
-							if (remain > 0 && start != conns[i].inbuf) memmove(conns[i].inbuf, start, remain);
-							conns[i].inlen = remain;
-							conns[i].inbuf[conns[i].inlen] = '\0';
-							// continue reading until EAGAIN
-							continue;
-						} else if (r == 0) {
-							// remote closed
-							close(conns[i].fd);
-							conns[i].fd = -1;
-							conns[i].inlen = 0;
-							break;
-						} else {
-							if (errno == EAGAIN || errno == EWOULDBLOCK) {
-								break;
-							} else {
-								// error
-								close(conns[i].fd);
-								conns[i].fd = -1;
-								conns[i].inlen = 0;
-								break;
-							}
-						}
-					}
-				} else if (p->revents & (POLLHUP | POLLERR)) {
-					close(conns[i].fd);
-					conns[i].fd = -1;
-					conns[i].inlen = 0;
-				}
-			}
-		}
-
-		// Check if it's time to print (could be after poll timeout or later)
-		now = epoch_ms_now();
-		if (now >= next_tick) {
-			// Use the scheduled tick time so printed timestamps align to 100ms
-			// boundaries instead of the actual (slightly delayed) current time.
-			long long ts = next_tick;
-			// print single JSON object line with flexible number of outputs
-			// build key names and compute max key length so colons align
-			char keybuf[MAX_PORT][16];
-			int max_key_len = 0;
-			for (int i = 0; i < MAX_PORT; ++i) {
-				snprintf(keybuf[i], sizeof(keybuf[i]), "out%d", i + 1);
-				int klen = (int)strlen(keybuf[i]);
-				if (klen > max_key_len) max_key_len = klen;
-			}
-
-			printf("{\"timestamp\": %lld", ts);
-			for (int i = 0; i < MAX_PORT; ++i) {
-				const char *val = conns[i].have ? conns[i].latest : "--";
-				// left-align key to max_key_len so the colon lines up, then a space and the quoted value
-				printf(", \"%-*s\": \"%s\"", max_key_len, keybuf[i], val);
-			}
-			printf("}\n");
-			fflush(stdout);
-
-			// reset window flags
-			for (int i = 0; i < MAX_PORT; ++i) conns[i].have = 0;
-
-			// advance next_tick by multiples of 100ms to catch up if delayed
-			do { next_tick += 100; } while (next_tick <= now);
-		}
-	}
-
-	return 0;
+	sc_options_free(&opts);
+	sc_client_stop_on_signals();
+	int rc = sc_client_run(&client, on_tick, NULL);
+	sc_client_free(&client);
+	return rc;
 }
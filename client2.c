@@ -1,288 +1,456 @@
 // client2.c
 // Like client1 but uses 20ms windows and sends control messages to server
-// to adjust output1 frequency/amplitude based on output3 value.
+// to adjust output1 frequency/amplitude based on output3 value. The
+// policy is a rule table (sigclient/rules.h), by default DEFAULT_RULES,
+// or loaded with -R. Rules run once per tick on the window's values, or
+// with -E as soon as each sample of a source stream arrives. Either way
+// the time from receiving the sample to the control send is recorded
+// per transition and reported at exit.
+//
+// The datagrams of every rule state (a WRITE and a verifying READ per
+// target) are built once at start-up and a transition sends them as one
+// sendmmsg batch on a connected UDP socket.
+//
+// The control socket is served by the event loop. READ responses are
+// matched to the outstanding request by object/property; a write counts
+// as acknowledged once the read-back returns the value written. Until
+// then the WRITE/READ pair of that target is resent every
+// CTRL_TIMEOUT_MS, up to CTRL_TRIES times. Round-trip times per target
+// are reported at exit.
+//
+// Writes pass through a per-target stage that keeps only the latest
+// desired value: a value equal to the last one the server read back is
+// dropped, and with -L each target draws on a token bucket, so a burst of
+// transitions inside the limit collapses into one write of the final
+// value when the next token is due. Resends draw from the same bucket.
 
-#define _POSIX_C_SOURCE 199309L
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <time.h>
-#include <sys/time.h>
-#include <poll.h>
 #include <math.h>
 
-#define MAX_PORT 3
-#define BUF_SIZE 2048
-#define TOKEN_MAX 512
+#include "sigclient/sigclient.h"
+#include "sigclient/rules.h"
+
+#define WINDOW_MS 20    // default, -w overrides
 #define CONTROL_PORT 4000
 
 // Debug macro - only prints if DEBUG is defined at compile time
 #ifdef DEBUG_ENABLED
 #define DEBUG(fmt, ...) fprintf(stderr, "[DEBUG] " fmt "\n", ##__VA_ARGS__)
 #else
-#define DEBUG(fmt, ...) /* disabled */
+#define DEBUG(fmt, ...) do {} while (0) /* disabled */
 #endif
 
 // Control protocol fields (16-bit unsigned big-endian)
 #define OP_READ 1
 #define OP_WRITE 2
-#define OBJ_OUT1 1
-#define PROP_FREQ 255      // Property ID 255 = Frequency
-#define PROP_AMP 170       // Property ID 170 = Amplitude
-
-struct conn {
-	int port;
-	int fd;
-	char inbuf[BUF_SIZE];
-	int inlen;
-	char latest[TOKEN_MAX];
-	int have;
-	time_t last_connect_try;
-};
 
-static long long epoch_ms_now(void) {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return (long long)tv.tv_sec * 1000LL + (tv.tv_usec / 1000LL);
-}
+// out3 >= 3.0: output1 (object 1) to 1kHz (frequency, property 255, in
+// the server's scale) and amplitude (property 170) 8000; below: 2kHz, 4000
+#define DEFAULT_SRC "out3"
+#define DEFAULT_RULES DEFAULT_SRC " >= 3.0 then 1:255=1000,1:170=8000 else 1:255=2000,1:170=4000"
 
-static int set_nonblocking(int fd) {
-	int flags = fcntl(fd, F_GETFL, 0);
-	if (flags == -1) return -1;
-	if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) return -1;
-	return 0;
-}
+#define CTRL_TIMEOUT_MS 50  // resend an unacknowledged pair after this long
+#define CTRL_TRIES 3        // transmissions before a write counts as lost
 
-static int connect_to_port(int port) {
-	int fd = socket(AF_INET, SOCK_STREAM, 0);
-	if (fd < 0) return -1;
+// Outstanding write of one target, acknowledged by its read-back
+struct request {
+	char name[16];      // "obj:prop"
+	uint16_t obj, prop;
+	int active;         // waiting for the read-back
+	uint16_t want;      // value written
+	struct mmsghdr *pair;   // its WRITE, READ messages
+	long long sent_ns;  // last transmission
+	long long due_ns;   // resend deadline
+	int tries;
+	struct sc_stats rtt;    // us, from the last transmission (Karn: a
+	                        // response to an earlier copy reads short)
+	struct sc_hist rtt_hist;    // ns, same samples, for the percentiles
+	int dirty;          // desired is waiting to be sent
+	uint16_t desired;
+	struct mmsghdr *desired_pair;
+	long long value_ns; // receipt of the sample desired comes from, 0 for a resend
+	int flushing;       // in the batch being sent
+	int known;          // the server's value has been read back
+	uint16_t known_value;
+	double tokens;      // -L bucket
+	long long refill_ns;
+	long acked, retries, lost, mismatched, suppressed, coalesced;
+};
+
+struct control {
+	int fd;         // connected to the control port
+	int tracking;   // fd is served by the event loop
+	struct sc_rules rules;
+	// messages 2a, 2a + 1 are the WRITE and READ of rules.actions[a]
+	uint16_t (*pkt)[2][4];
+	struct iovec *iov;
+	struct mmsghdr *msgs;
+	struct request *req;    // per rules target
+	struct mmsghdr *outbox; // pairs due in this flush
+	double rate, burst;     // -L: writes per second per target, 0 = unlimited
+	long unmatched;         // responses for no known target
+	int on_arrival;         // -E: rules run in on_sample instead of on_tick
+	struct sc_stats latency;    // us from sample receipt to its control writes being sent
+};
+
+// UDP socket connected to the control port, so sends need no address
+static int create_control_socket(const char *host, int port) {
 	struct sockaddr_in addr;
 	memset(&addr, 0, sizeof(addr));
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(port);
-	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
-	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-		close(fd);
-		return -1;
-	}
-	if (set_nonblocking(fd) < 0) {
+	inet_pton(AF_INET, host, &addr.sin_addr);
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) < 0) {
 		close(fd);
 		return -1;
 	}
 	return fd;
 }
 
-static void trim(char *s) {
-	int i = 0, j = strlen(s) - 1;
-	while (i <= j && (s[i] == '\n' || s[i] == '\r' || s[i] == ' ' || s[i] == '\t')) i++;
-	while (j >= i && (s[j] == '\n' || s[j] == '\r' || s[j] == ' ' || s[j] == '\t')) j--;
-	if (i == 0 && j == (int)strlen(s) - 1) return;
-	if (i > j) { s[0] = '\0'; return; }
-	memmove(s, s + i, j - i + 1);
-	s[j - i + 1] = '\0';
+// Fill message k: a WRITE when nfields is 4, a READ when it is 3
+static void build_command(struct control *ctl, int k, uint16_t op, uint16_t obj, uint16_t prop, uint16_t val, int nfields) {
+	uint16_t *m = ctl->pkt[k / 2][k % 2];
+	m[0] = htons(op);
+	m[1] = htons(obj);
+	m[2] = htons(prop);
+	m[3] = htons(val);
+	ctl->iov[k].iov_base = m;
+	ctl->iov[k].iov_len = (size_t)nfields * sizeof(uint16_t);
+	memset(&ctl->msgs[k], 0, sizeof(ctl->msgs[k]));
+	ctl->msgs[k].msg_hdr.msg_iov = &ctl->iov[k];
+	ctl->msgs[k].msg_hdr.msg_iovlen = 1;
 }
 
-static int create_control_socket(void) {
-	int fd = socket(AF_INET, SOCK_DGRAM, 0);
-	if (fd < 0) return -1;
-	return fd;
+// Precompute every action's WRITE and READ, and the request table, in
+// the client's arena
+static int build_messages(struct control *ctl, struct sc_arena *a) {
+	const struct sc_rules *rs = &ctl->rules;
+	ctl->pkt = sc_arena_array(a, rs->nactions + 1, sizeof(*ctl->pkt));
+	ctl->iov = sc_arena_array(a, 2 * rs->nactions + 1, sizeof(*ctl->iov));
+	ctl->msgs = sc_arena_array(a, 2 * rs->nactions + 1, sizeof(*ctl->msgs));
+	ctl->req = sc_arena_array(a, rs->ntargets + 1, sizeof(*ctl->req));
+	ctl->outbox = sc_arena_array(a, 2 * rs->ntargets + 1, sizeof(*ctl->outbox));
+	if (!ctl->pkt || !ctl->iov || !ctl->msgs || !ctl->req || !ctl->outbox) return -1;
+	for (int a = 0; a < rs->nactions; ++a) {
+		const struct sc_rule_target *t = &rs->targets[rs->actions[a].target];
+		build_command(ctl, 2 * a, OP_WRITE, t->obj, t->prop, rs->actions[a].value, 4);
+		build_command(ctl, 2 * a + 1, OP_READ, t->obj, t->prop, 0, 3);
+	}
+	for (int i = 0; i < rs->ntargets; ++i) {
+		struct request *rq = &ctl->req[i];
+		rq->obj = rs->targets[i].obj;
+		rq->prop = rs->targets[i].prop;
+		snprintf(rq->name, sizeof(rq->name), "%u:%u", rq->obj, rq->prop);
+		sc_stats_reset(&rq->rtt);
+		rq->tokens = ctl->burst;
+	}
+	return 0;
+}
+
+// One sendmmsg for messages [0, n), continuing after a partial send. A
+// connected UDP socket reports an earlier ICMP refusal on the next send;
+// that does not concern these messages, so it is retried once.
+static int send_msgs(int fd, struct mmsghdr *msgs, int n) {
+	int sent = 0, refused = 0;
+	while (sent < n) {
+		int r = sendmmsg(fd, msgs + sent, n - sent, 0);
+		if (r < 0) {
+			if (errno == EINTR || (errno == ECONNREFUSED && !refused++)) continue;
+			return -1;
+		}
+		sent += r;
+	}
+	return 0;
+}
+
+static struct request *find_request(struct control *ctl, uint16_t obj, uint16_t prop) {
+	for (int i = 0; i < ctl->rules.ntargets; ++i)
+		if (ctl->req[i].obj == obj && ctl->req[i].prop == prop) return &ctl->req[i];
+	return NULL;
 }
 
-static void send_read_command(int fd, struct sockaddr_in *addr, uint16_t obj, uint16_t prop) {
-	uint16_t msg[3];
-	msg[0] = htons(OP_READ);
-	msg[1] = htons(obj);
-	msg[2] = htons(prop);
-	sendto(fd, msg, sizeof(msg), MSG_CONFIRM, (const struct sockaddr *)addr, sizeof(*addr));
+// A read-back arrived: obj/prop/value of the response
+static void handle_response(struct control *ctl, uint16_t obj, uint16_t prop, uint16_t val, long long now_ns) {
+	struct request *rq = find_request(ctl, obj, prop);
+	if (!rq) {
+		ctl->unmatched++;
+		return;
+	}
+	rq->known = 1;
+	rq->known_value = val;
+	if (!rq->active) return;    // duplicate or late answer to a resend
+	sc_stats_add(&rq->rtt, (double)(now_ns - rq->sent_ns) / 1e3);
+	sc_hist_add(&rq->rtt_hist, now_ns - rq->sent_ns);
+	if (val == rq->want) {
+		rq->active = 0;
+		rq->acked++;
+	} else {
+		// not applied (yet); the resend deadline takes care of it
+		rq->mismatched++;
+		DEBUG("%s reads back %u, wrote %u", rq->name, val, rq->want);
+	}
 }
 
-int main(void) {
-    struct conn conns[MAX_PORT];
-    int ports[MAX_PORT] = {4001, 4002, 4003};
-    for (int i = 0; i < MAX_PORT; ++i) {
-        conns[i].port = ports[i];
-        conns[i].fd = -1;
-        conns[i].inlen = 0;
-        conns[i].latest[0] = '\0';
-        conns[i].have = 0;
-        conns[i].last_connect_try = 0;
-    }
-
-    // Create UDP control socket
-    int ctrl_fd = create_control_socket();
-    struct sockaddr_in ctrl_addr;
-    memset(&ctrl_addr, 0, sizeof(ctrl_addr));
-    ctrl_addr.sin_family = AF_INET;
-    ctrl_addr.sin_port = htons(CONTROL_PORT);
-    inet_pton(AF_INET, "127.0.0.1", &ctrl_addr.sin_addr);
-
-    long long now_ms = epoch_ms_now();
-    long long next_tick = now_ms + (20 - (now_ms % 20));
-
-    int last_state = -1; // -1 unknown, 0 <3.0, 1 >=3.0
-
-    while (1) {
-        long long now_try = epoch_ms_now();
-        for (int i = 0; i < MAX_PORT; ++i) {
-            if (conns[i].fd < 0) {
-                if (now_try - (long long)conns[i].last_connect_try >= 1000) {
-                    conns[i].last_connect_try = now_try;
-                    int fd = connect_to_port(conns[i].port);
-                    if (fd >= 0) {
-                        conns[i].fd = fd;
-                        conns[i].inlen = 0;
-                        conns[i].have = 0;
-                        conns[i].latest[0] = '\0';
-                    }
-                }
-            }
-        }
-
-        int nfds = 0;
-        struct pollfd pfds[MAX_PORT];
-        for (int i = 0; i < MAX_PORT; ++i) {
-            if (conns[i].fd >= 0) {
-                pfds[nfds].fd = conns[i].fd;
-                pfds[nfds].events = POLLIN | POLLHUP | POLLERR;
-                pfds[nfds].revents = 0;
-                nfds++;
-            }
-        }
-
-        long long now = epoch_ms_now();
-        long long timeout = next_tick - now;
-        if (timeout < 0) timeout = 0;
-        if (timeout > 2000) timeout = 2000;
-
-        int poll_res = 0;
-        if (nfds > 0) poll_res = poll(pfds, nfds, (int)timeout);
-        else {
-            struct timespec ts;
-            ts.tv_sec = timeout / 1000;
-            ts.tv_nsec = (timeout % 1000) * 1000000;
-            nanosleep(&ts, NULL);
-        }
-
-        if (poll_res > 0) {
-            int idx = 0;
-            for (int i = 0; i < MAX_PORT; ++i) {
-                if (conns[i].fd < 0) continue;
-                struct pollfd *p = &pfds[idx++];
-                if (p->revents & POLLIN) {
-                    while (1) {
-                        ssize_t r = recv(conns[i].fd, conns[i].inbuf + conns[i].inlen, sizeof(conns[i].inbuf) - conns[i].inlen - 1, 0);
-                        if (r > 0) {
-                            conns[i].inlen += r;
-                            conns[i].inbuf[conns[i].inlen] = '\0';
-                            char *start = conns[i].inbuf;
-                            char *pnl;
-                            while ((pnl = strpbrk(start, "\r\n")) != NULL) {
-                                size_t len = pnl - start;
-                                char token[TOKEN_MAX];
-                                if (len >= sizeof(token)) len = sizeof(token) - 1;
-                                memcpy(token, start, len);
-                                token[len] = '\0';
-                                trim(token);
-                                if (token[0] != '\0') {
-                                    size_t clen = strlen(token);
-                                    if (clen > sizeof(conns[i].latest) - 1) clen = sizeof(conns[i].latest) - 1;
-                                    memcpy(conns[i].latest, token, clen);
-                                    conns[i].latest[clen] = '\0';
-                                    conns[i].have = 1;
-                                }
-                                start = pnl + 1;
-                            }
-                            int remain = conns[i].inlen - (start - conns[i].inbuf);
-                            if (remain > 0 && start != conns[i].inbuf) memmove(conns[i].inbuf, start, remain);
-                            conns[i].inlen = remain;
-                            conns[i].inbuf[conns[i].inlen] = '\0';
-                            continue;
-                        } else if (r == 0) {
-                            close(conns[i].fd);
-                            conns[i].fd = -1;
-                            conns[i].inlen = 0;
-                            break;
-                        } else {
-                            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
-                            close(conns[i].fd);
-                            conns[i].fd = -1;
-                            conns[i].inlen = 0;
-                            break;
-                        }
-                    }
-                } else if (p->revents & (POLLHUP | POLLERR)) {
-                    close(conns[i].fd);
-                    conns[i].fd = -1;
-                    conns[i].inlen = 0;
-                }
-            }
-        }
-
-        now = epoch_ms_now();
-        if (now >= next_tick) {
-            long long ts = next_tick;
-            const char *o1 = conns[0].have ? conns[0].latest : "--";
-            const char *o2 = conns[1].have ? conns[1].latest : "--";
-            const char *o3 = conns[2].have ? conns[2].latest : "--";
-
-            // control logic based on out3
-            double v3 = 0.0/0.0; // NaN
-            if (conns[2].have) {
-                char *endptr = NULL;
-                v3 = strtod(conns[2].latest, &endptr);
-                if (endptr == conns[2].latest) v3 = 0.0/0.0;
-            }
-            int state = -1;
-            if (!isnan(v3)) {
-                state = (v3 >= 3.0) ? 1 : 0;
-            }
-
-            if (state != -1 && state != last_state) {
-                // send settings to output1 over UDP control port
-                DEBUG("State change detected: %d -> %d, out3=%.1f", last_state, state, v3);
-                if (ctrl_fd >= 0) {
-                    if (state == 1) {
-                        // >=3.0 -> freq 1kHz (1000), amp 8000
-                        DEBUG("Sending: freq=1000 (1kHz), amp=8000 (threshold reached)");
-                        sendto(ctrl_fd, &(uint16_t[4]){htons(OP_WRITE), htons(OBJ_OUT1), htons(PROP_FREQ), htons(1000)}, 8, MSG_CONFIRM, (const struct sockaddr *)&ctrl_addr, sizeof(ctrl_addr));
-                        sendto(ctrl_fd, &(uint16_t[4]){htons(OP_WRITE), htons(OBJ_OUT1), htons(PROP_AMP), htons(8000)}, 8, MSG_CONFIRM, (const struct sockaddr *)&ctrl_addr, sizeof(ctrl_addr));
-                        // Verify by reading back
-                        DEBUG("Verifying frequency and amplitude...");
-                        send_read_command(ctrl_fd, &ctrl_addr, OBJ_OUT1, PROP_FREQ);
-                        send_read_command(ctrl_fd, &ctrl_addr, OBJ_OUT1, PROP_AMP);
-                    } else {
-                        // <3.0 -> freq 2kHz (2000), amp 4000
-                        DEBUG("Sending: freq=2000 (2kHz), amp=4000 (threshold not reached)");
-                        sendto(ctrl_fd, &(uint16_t[4]){htons(OP_WRITE), htons(OBJ_OUT1), htons(PROP_FREQ), htons(2000)}, 8, MSG_CONFIRM, (const struct sockaddr *)&ctrl_addr, sizeof(ctrl_addr));
-                        sendto(ctrl_fd, &(uint16_t[4]){htons(OP_WRITE), htons(OBJ_OUT1), htons(PROP_AMP), htons(4000)}, 8, MSG_CONFIRM, (const struct sockaddr *)&ctrl_addr, sizeof(ctrl_addr));
-                        // Verify by reading back
-                        DEBUG("Verifying frequency and amplitude...");
-                        send_read_command(ctrl_fd, &ctrl_addr, OBJ_OUT1, PROP_FREQ);
-                        send_read_command(ctrl_fd, &ctrl_addr, OBJ_OUT1, PROP_AMP);
-                    }
-                } else {
-                    DEBUG("ERROR: Control socket not available (fd=%d)", ctrl_fd);
-                }
-                last_state = state;
-            }
-
-            // print JSON line
-            printf("{\"timestamp\": %lld, \"out1\": \"%s\", \"out2\": \"%s\", \"out3\": \"%s\"}\n",
-                   ts, o1, o2, o3);
-            fflush(stdout);
-
-            for (int i = 0; i < MAX_PORT; ++i) conns[i].have = 0;
-
-            do { next_tick += 20; } while (next_tick <= now);
-        }
-    }
-
-    return 0;
+static long long earlier(long long a, long long b) {
+	return !a || (b && b < a) ? b : a;
+}
+
+// Queue resends of pairs past their deadline; returns the next deadline,
+// 0 if nothing is outstanding
+static long long check_requests(struct control *ctl, long long now_ns) {
+	long long next = 0;
+	for (int i = 0; i < ctl->rules.ntargets; ++i) {
+		struct request *rq = &ctl->req[i];
+		if (!rq->active || rq->dirty) continue;  // a pending value goes first
+		if (now_ns < rq->due_ns) {
+			next = earlier(next, rq->due_ns);
+		} else if (rq->tries >= CTRL_TRIES) {
+			DEBUG("%s=%u not acknowledged after %d tries", rq->name, rq->want, rq->tries);
+			rq->active = 0;
+			rq->lost++;
+		} else {
+			rq->dirty = 1;
+			rq->desired = rq->want;
+			rq->desired_pair = rq->pair;
+			rq->value_ns = 0;
+		}
+	}
+	return next;
+}
+
+// One latency per transition whose writes were in the batch just sent:
+// its targets share the sample's value_ns. Resends carry none.
+static void record_latency(struct control *ctl, int ok, long long done_ns) {
+	for (int i = 0; i < ctl->rules.ntargets; ++i) {
+		struct request *rq = &ctl->req[i];
+		if (!rq->flushing) continue;
+		rq->flushing = 0;
+		long long v = rq->value_ns;
+		if (!v) continue;
+		for (int j = i; j < ctl->rules.ntargets; ++j)
+			if (ctl->req[j].flushing && ctl->req[j].value_ns == v) ctl->req[j].value_ns = 0;
+		rq->value_ns = 0;
+		if (ok) sc_stats_add(&ctl->latency, (double)(done_ns - v) / 1e3);
+	}
+}
+
+// Send the pending value of every target that has a token, as one batch.
+// Returns the number of targets written; *next is when a deferred one
+// gets its next token (left alone if none is deferred).
+static int flush_targets(struct control *ctl, long long now_ns, long long *next) {
+	int n = 0;
+	for (int i = 0; i < ctl->rules.ntargets; ++i) {
+		struct request *rq = &ctl->req[i];
+		if (!rq->dirty) continue;
+		if (rq->active && rq->want == rq->desired && now_ns < rq->due_ns) {
+			rq->dirty = 0;      // already in flight
+			continue;
+		}
+		if (!rq->active && rq->known && rq->known_value == rq->desired) {
+			rq->dirty = 0;      // the server already has it
+			rq->suppressed++;
+			continue;
+		}
+		if (ctl->rate > 0) {
+			rq->tokens += (double)(now_ns - rq->refill_ns) * ctl->rate / 1e9;
+			if (rq->tokens > ctl->burst) rq->tokens = ctl->burst;
+			rq->refill_ns = now_ns;
+			if (rq->tokens < 1) {
+				*next = earlier(*next, now_ns + (long long)ceil((1 - rq->tokens) * 1e9 / ctl->rate));
+				continue;
+			}
+			rq->tokens -= 1;
+		}
+		if (rq->active && rq->want == rq->desired) {
+			rq->tries++;
+			rq->retries++;
+		} else {
+			if (rq->active) rq->lost++;     // superseded before it was acknowledged
+			rq->tries = 1;
+		}
+		rq->dirty = 0;
+		rq->active = 1;
+		rq->want = rq->desired;
+		rq->pair = rq->desired_pair;
+		rq->sent_ns = now_ns;
+		rq->due_ns = now_ns + CTRL_TIMEOUT_MS * SC_NS_PER_MS;
+		rq->flushing = 1;
+		ctl->outbox[2 * n] = rq->pair[0];
+		ctl->outbox[2 * n + 1] = rq->pair[1];
+		n++;
+	}
+	if (!n) return 0;
+	int ok = send_msgs(ctl->fd, ctl->outbox, 2 * n) == 0;
+	if (!ok) DEBUG("ERROR: control send failed: %s", strerror(errno));
+	record_latency(ctl, ok, sc_mono_ns());
+	return n;
+}
+
+// Resends and deferred writes; returns the next deadline for the watch
+static long long service(struct control *ctl, long long now_ns) {
+	long long next = check_requests(ctl, now_ns);
+	flush_targets(ctl, now_ns, &next);
+	return next;
+}
+
+// Event loop callback for the control socket
+static long long on_control(struct sc_client *c, int readable, long long now_ns, void *arg) {
+	(void)c;
+	struct control *ctl = arg;
+	while (readable) {
+		uint16_t m[4];
+		ssize_t r = recv(ctl->fd, m, sizeof(m), 0);
+		if (r < 0) {
+			if (errno == EINTR) continue;
+			break;  // EAGAIN, or a refusal reported by the kernel
+		}
+		if (r < (ssize_t)sizeof(m)) {
+			ctl->unmatched++;
+			continue;
+		}
+		handle_response(ctl, ntohs(m[1]), ntohs(m[2]), ntohs(m[3]), now_ns);
+	}
+	return service(ctl, now_ns);
+}
+
+// Write the actions of rule r's new state for a sample received at
+// value_ns (monotonic). Without tracking there is no timer to drain the
+// coalescing stage, so they are sent straight away.
+static void fire(struct sc_client *c, struct control *ctl, const struct sc_rule *r, long long value_ns) {
+	int s = r->state, first = r->first[s], n = r->count[s];
+	DEBUG("Rule on %s now %s, %d writes", c->streams[r->src - c->base].name, s ? "true" : "false", n);
+	if (ctl->fd < 0 || n == 0) return;
+	if (!ctl->tracking) {
+		if (send_msgs(ctl->fd, ctl->msgs + 2 * first, 2 * n) < 0)
+			DEBUG("ERROR: control send failed: %s", strerror(errno));
+		else
+			sc_stats_add(&ctl->latency, (double)(sc_mono_ns() - value_ns) / 1e3);
+		return;
+	}
+	for (int a = first; a < first + n; ++a) {
+		struct request *rq = &ctl->req[ctl->rules.actions[a].target];
+		if (rq->dirty) rq->coalesced++;     // replaces a value never sent
+		rq->dirty = 1;
+		rq->desired = ctl->rules.actions[a].value;
+		rq->desired_pair = ctl->msgs + 2 * a;
+		rq->value_ns = value_ns;
+	}
+	sc_client_watch_due(c, service(ctl, sc_mono_ns()));
+}
+
+static void on_sample(struct sc_client *c, int stream, double value, long long value_ns, void *arg) {
+	struct control *ctl = arg;
+	struct sc_rules *rs = &ctl->rules;
+	for (int k = rs->by_src[stream]; k < rs->by_src[stream + 1]; ++k)
+		if (sc_rule_eval(&rs->rules[k], value)) fire(c, ctl, &rs->rules[k], value_ns);
+}
+
+static void on_tick(struct sc_client *c, long long ts_ns, void *arg) {
+	struct control *ctl = arg;
+
+	// control rules on the window's values (parsed on arrival, NaN if none)
+	for (int k = 0; !ctl->on_arrival && k < ctl->rules.nrules; ++k) {
+		struct sc_rule *r = &ctl->rules.rules[k];
+		if (sc_rule_eval(r, sc_client_number(c, r->src))) fire(c, ctl, r, sc_client_value_ns(c, r->src));
+	}
+
+	sc_client_output(c, ts_ns);
+}
+
+int main(int argc, char **argv) {
+	struct sc_options opts;
+	sc_options_init(&opts);
+	if (sc_options_parse(&opts, argc, argv) < 0) return 2;
+
+	struct sc_client client;
+	if (sc_client_init(&client, &opts, WINDOW_MS * SC_NS_PER_MS) < 0) {
+		perror("sc_client_init");
+		sc_options_free(&opts);
+		return 1;
+	}
+	sc_client_stop_on_signals();
+
+	// from here on every exit goes through out: sc_client_free closes the
+	// capture segment, unlinks the -P ring and socket and joins the threads
+	int rc = 1;
+
+	struct control ctl;
+	memset(&ctl, 0, sizeof(ctl));
+	sc_stats_reset(&ctl.latency);
+	ctl.rate = opts.ctrl_rate;
+	ctl.burst = opts.ctrl_burst;
+	if (opts.rules_path) {
+		if (sc_rules_load(&ctl.rules, opts.rules_path, &client) < 0) {
+			rc = 2;
+			goto out;
+		}
+	} else if (sc_client_find(&client, DEFAULT_SRC) < 0) {
+		fprintf(stderr, "client2: no '%s' stream configured, control disabled\n", DEFAULT_SRC);
+	} else if (sc_rules_parse(&ctl.rules, DEFAULT_RULES, "default rules", &client) < 0) {
+		goto out;
+	}
+
+	// -E with -j runs rules on shard threads; they share one control
+	// state, so all sources must be the same stream there
+	ctl.on_arrival = opts.on_arrival;
+	int src = ctl.rules.nrules ? ctl.rules.rules[0].src : -1;
+	if (ctl.on_arrival && opts.shards && ctl.rules.nrules && ctl.rules.rules[ctl.rules.nrules - 1].src != src) {
+		fprintf(stderr, "client2: -E with -j needs a single rule source stream, evaluating per tick\n");
+		ctl.on_arrival = 0;
+	}
+	for (int k = 0; k < ctl.rules.nrules; ++k) {
+		int i = ctl.rules.rules[k].src;
+		if (ctl.on_arrival) sc_client_notify(&client, i, on_sample, &ctl);
+		else sc_client_set_numeric(&client, i);
+	}
+
+	// Create UDP control socket
+	ctl.fd = create_control_socket(SC_DEFAULT_HOST, CONTROL_PORT);
+	if (ctl.fd < 0) perror("client2: control socket");
+	if (build_messages(&ctl, client.arena) < 0) {
+		perror("client2");
+		goto out;
+	}
+
+	// responses are handled on the thread that sends the requests
+	if (ctl.fd >= 0 && ctl.rules.nrules) {
+		if (sc_client_watch(&client, ctl.on_arrival ? src : -1, ctl.fd, on_control, &ctl) == 0) ctl.tracking = 1;
+		else perror("client2: watching the control socket");
+	}
+
+	rc = sc_client_run(&client, on_tick, &ctl);
+	if (ctl.latency.count)
+		fprintf(stderr, "client2: %ld transitions (%s), control latency us min %.1f mean %.1f max %.1f\n",
+			ctl.latency.count, ctl.on_arrival ? "on arrival" : "per tick",
+			ctl.latency.min, ctl.latency.mean, ctl.latency.max);
+	for (int i = 0; ctl.tracking && i < ctl.rules.ntargets; ++i) {
+		const struct request *rq = &ctl.req[i];
+		if (!rq->acked && !rq->lost && !rq->retries && !rq->suppressed && !rq->coalesced) continue;
+		fprintf(stderr, "client2: %s: %ld acked, %ld retries, %ld lost, %ld mismatched, %ld suppressed, %ld coalesced",
+			rq->name, rq->acked, rq->retries, rq->lost, rq->mismatched, rq->suppressed, rq->coalesced);
+		if (rq->rtt.count)
+			fprintf(stderr, ", rtt us min %.1f mean %.1f max %.1f p50 %.1f p99 %.1f", rq->rtt.min, rq->rtt.mean, rq->rtt.max,
+				(double)sc_hist_quantile(&rq->rtt_hist, 0.5) / 1e3, (double)sc_hist_quantile(&rq->rtt_hist, 0.99) / 1e3);
+		fputc('\n', stderr);
+	}
+	if (ctl.unmatched) fprintf(stderr, "client2: %ld unmatched control responses\n", ctl.unmatched);
+
+out:
+	sc_client_free(&client);
+	sc_rules_free(&ctl.rules);
+	sc_options_free(&opts);
+	return rc;
 }
@@ -0,0 +1,347 @@
+// analysis.c
+// Streaming analysis (-F): what analyzer/analyze.py works out from a
+// recorded file, kept up to date while the client runs. At every tick the
+// loop queues each stream's window value (a handful of stores, see
+// sc_analysis_push); everything else runs on a background thread:
+//
+// - a sliding history of the last len windows per stream, with running
+//   sums for the mean and RMS and monotonic deques for the peaks, so each
+//   new window costs O(1)
+// - every interval, a Hann-windowed radix-2 FFT over the newest power of
+//   two windows (at most len): the dominant frequency, refined between
+//   bins, and the first harmonics, which give the shape with the same
+//   heuristic as analyze.py
+//
+// The result is one JSON line per interval, e.g.
+//
+//   {"timestamp": 1702000000100, "analysis": {"out1": {"freq_hz": 0.5, "p2p": 8, "rms": 2.83, "shape": "sine-like", "n": 256}, ...}}
+//
+// handed back to the tick loop through a second ring and written with the
+// window lines. A stream without a sample in the analysed windows is null.
+
+#define _DEFAULT_SOURCE     // M_PI
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include "sigclient.h"
+
+#define ROW_BATCH 64            // rows drained at a time
+
+static const char *const shapes[] = {
+	"flat", "sine-like", "square-like", "triangle-like", "sawtooth-like", "complex/unknown",
+};
+
+// One window's value: the latest sample, or for an aggregated stream the
+// last one, as analyze.py reads the output
+static double window_value(const struct sc_client *c, int i) {
+	const struct sc_conn *conn = &c->conns[i];
+	if (c->streams[i].agg) return sc_stats_field(conn->stats, SC_AGG_LAST);
+	return sc_conn_number(conn);
+}
+
+// Tick thread: queue the window's values; dropped if the thread is behind
+void sc_analysis_push(struct sc_client *c, long long ts_ns) {
+	struct sc_analysis *a = c->analysis;
+	char *row = sc_ring_claim(&a->rows);
+	if (!row) return;
+	memcpy(row, &ts_ns, sizeof(ts_ns));
+	double *v = (double *)(row + sizeof(ts_ns));
+	for (int i = 0; i < c->nconns; ++i) v[i] = window_value(c, i);
+	sc_ring_publish(&a->rows, a->row_size);
+}
+
+// Tick thread: the lines that are ready, in a->take. Nobody waits on
+// results.items, so its count is left to grow.
+size_t sc_analysis_take(struct sc_analysis *a) {
+	return sc_ring_drain(&a->results, a->take, a->line_max);
+}
+
+static void push_value(struct sc_analysis *a, struct sc_analysis_stream *s, double v) {
+	int have = !isnan(v);
+	if (have) s->held = v;
+	else if (isnan(s->held)) return;
+	else v = s->held;
+
+	unsigned mask = a->len - 1;
+	unsigned long long n = s->n++;
+	unsigned slot = (unsigned)(n & mask);
+	if (s->filled == a->len) {
+		double old = s->x[slot];
+		s->sum -= old;
+		s->sumsq -= old * old;
+		s->present -= s->have[slot];
+		if (s->maxq[s->maxh & mask] + a->len <= n) s->maxh++;
+		if (s->minq[s->minh & mask] + a->len <= n) s->minh++;
+	} else {
+		s->filled++;
+	}
+	s->x[slot] = v;
+	s->sum += v;
+	s->sumsq += v * v;
+	s->have[slot] = (unsigned char)have;
+	s->present += (unsigned)have;
+	while (s->maxt != s->maxh && s->x[s->maxq[(s->maxt - 1) & mask] & mask] <= v) s->maxt--;
+	s->maxq[s->maxt++ & mask] = n;
+	while (s->mint != s->minh && s->x[s->minq[(s->mint - 1) & mask] & mask] >= v) s->mint--;
+	s->minq[s->mint++ & mask] = n;
+
+	// the running sums drift; start them over once per lap
+	if (slot == mask) {
+		s->sum = s->sumsq = 0;
+		for (unsigned i = 0; i < s->filled; ++i) {
+			s->sum += s->x[i];
+			s->sumsq += s->x[i] * s->x[i];
+		}
+	}
+}
+
+// In-place forward FFT of re/im[0..n), n a power of two dividing len
+static void fft(struct sc_analysis *a, unsigned n) {
+	double *re = a->re, *im = a->im;
+	for (unsigned i = 1, j = 0; i < n; ++i) {
+		unsigned bit = n >> 1;
+		for (; j & bit; bit >>= 1) j ^= bit;
+		j |= bit;
+		if (i < j) {
+			double t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+	for (unsigned size = 2; size <= n; size <<= 1) {
+		unsigned half = size >> 1, step = a->len / size;
+		for (unsigned i = 0; i < n; i += size) {
+			for (unsigned j = 0; j < half; ++j) {
+				double wr = a->cosv[j * step], wi = a->sinv[j * step];
+				unsigned p = i + j, q = p + half;
+				double tr = re[q] * wr - im[q] * wi;
+				double ti = re[q] * wi + im[q] * wr;
+				re[q] = re[p] - tr;
+				im[q] = im[p] - ti;
+				re[p] += tr;
+				im[p] += ti;
+			}
+		}
+	}
+}
+
+struct result {
+	double freq, p2p, rms;
+	int shape;
+	unsigned n;
+};
+
+// analyze.py's heuristic: a lone fundamental is a sine, odd harmonics a
+// square or (falling fast) a triangle, a slower 1/n fall a sawtooth
+static int classify(const double *h) {
+	double top = 0;
+	for (int k = 0; k < SC_ANALYSIS_HARMONICS; ++k) if (h[k] > top) top = h[k];
+	if (top == 0) return 0;
+	int sine = 1;
+	for (int k = 1; k < SC_ANALYSIS_HARMONICS; ++k) if (h[k] >= 0.2 * h[0]) sine = 0;
+	if (sine) return 1;
+
+	// slope of log amplitude over log harmonic number; harmonics under 1%
+	// of the fundamental are window leakage rather than the shape
+	double sx = 0, sy = 0, sxx = 0, sxy = 0, decay = 0;
+	int m = 0;
+	for (int k = 0; k < SC_ANALYSIS_HARMONICS; ++k) {
+		if (h[k] < 0.01 * h[0]) continue;
+		double x = log(k + 1), y = log(h[k]);
+		sx += x, sy += y, sxx += x * x, sxy += x * y, m++;
+	}
+	if (m >= 3) decay = (m * sxy - sx * sy) / (m * sxx - sx * sx);
+	double odd = 0, even = 0;
+	for (int k = 0; k < SC_ANALYSIS_HARMONICS; ++k) {
+		if (k & 1) even += h[k];    // h[0] is the fundamental, an odd harmonic
+		else odd += h[k];
+	}
+	if (odd > 2 * even) return decay < -1.5 ? 3 : 2;
+	return decay < -1.5 ? 3 : decay < -0.7 ? 4 : 5;
+}
+
+static void analyze_stream(struct sc_analysis *a, const struct sc_analysis_stream *s, struct result *r) {
+	unsigned mask = a->len - 1, n = 1;
+	while (n * 2 <= s->filled) n <<= 1;
+	double mean = s->sum / s->filled;
+	double var = s->sumsq / s->filled - mean * mean;
+	r->rms = var > 0 ? sqrt(var) : 0;
+	r->p2p = s->x[s->maxq[s->maxh & mask] & mask] - s->x[s->minq[s->minh & mask] & mask];
+	r->freq = 0;
+	r->shape = 0;
+	r->n = n;
+	if (r->p2p == 0) return;
+
+	// the newest n values, detrended and Hann-windowed
+	unsigned long long first = s->n - n;
+	double m = 0;
+	for (unsigned i = 0; i < n; ++i) m += s->x[(first + i) & mask];
+	m /= n;
+	unsigned step = a->len / n;
+	for (unsigned i = 0; i < n; ++i) {
+		a->re[i] = (s->x[(first + i) & mask] - m) * (0.5 - 0.5 * a->cosv[i * step]);
+		a->im[i] = 0;
+	}
+	fft(a, n);
+	unsigned nyq = n / 2, peak = 1;
+	for (unsigned k = 1; k <= nyq; ++k) {
+		a->mag[k] = hypot(a->re[k], a->im[k]);
+		if (a->mag[k] > a->mag[peak]) peak = k;
+	}
+	if (a->mag[peak] == 0) return;
+
+	// parabola through the log magnitudes around the peak bin
+	double bin = peak;
+	if (peak > 1 && peak < nyq && a->mag[peak - 1] > 0 && a->mag[peak + 1] > 0) {
+		double l = log(a->mag[peak - 1]), c = log(a->mag[peak]), h = log(a->mag[peak + 1]);
+		double d = l - 2 * c + h;
+		if (d < 0) bin += 0.5 * (l - h) / d;
+	}
+	r->freq = bin * a->fs / n;
+
+	// a harmonic's peak, a bin either way when the Hann main lobes (two
+	// bins wide on each side) of neighbouring harmonics do not overlap
+	double harm[SC_ANALYSIS_HARMONICS];
+	long spread = bin >= 4 ? 1 : 0;
+	for (int k = 0; k < SC_ANALYSIS_HARMONICS; ++k) {
+		long b = lround((k + 1) * bin);
+		harm[k] = 0;
+		for (long j = b - spread; j <= b + spread; ++j)
+			if (j >= 1 && j <= (long)nyq && a->mag[j] > harm[k]) harm[k] = a->mag[j];
+	}
+	r->shape = classify(harm);
+}
+
+static size_t put_record(struct sc_analysis *a, long long ts_ns) {
+	char *p = a->line, *end = a->line + a->line_max;
+	if (a->timestamp_us) p += snprintf(p, end - p, "{\"timestamp_us\": %lld, \"analysis\": {", ts_ns / 1000);
+	else p += snprintf(p, end - p, "{\"timestamp\": %lld, \"analysis\": {", ts_ns / SC_NS_PER_MS);
+	for (int i = 0; i < a->nconns; ++i) {
+		const struct sc_analysis_stream *s = &a->st[i];
+		p += snprintf(p, end - p, "%s\"%s\": ", i ? ", " : "", a->streams[i].name);
+		if (s->filled < SC_ANALYSIS_MIN || !s->present) {
+			p += snprintf(p, end - p, "null");
+			continue;
+		}
+		struct result r;
+		analyze_stream(a, s, &r);
+		p += snprintf(p, end - p, "{\"freq_hz\": %.6g, \"p2p\": %.6g, \"rms\": %.6g, \"shape\": \"%s\", \"n\": %u}",
+			r.freq, r.p2p, r.rms, shapes[r.shape], r.n);
+	}
+	p += snprintf(p, end - p, "}}\n");
+	return p - a->line;
+}
+
+static void add_row(struct sc_analysis *a, const char *row) {
+	long long ts_ns;
+	memcpy(&ts_ns, row, sizeof(ts_ns));
+	const double *v = (const double *)(row + sizeof(ts_ns));
+	for (int i = 0; i < a->nconns; ++i) push_value(a, &a->st[i], v[i]);
+	if (++a->since < a->every) return;
+	a->since = 0;
+	size_t n = put_record(a, ts_ns);
+	char *slot = sc_ring_claim(&a->results);
+	if (!slot) return;
+	memcpy(slot, a->line, n);
+	sc_ring_publish(&a->results, n);
+}
+
+static void *analysis_main(void *arg) {
+	struct sc_analysis *a = arg;
+	for (;;) {
+		int closing = atomic_load(&a->closing);
+		size_t n = sc_ring_drain(&a->rows, a->rowbuf, ROW_BATCH * a->row_size);
+		if (n) {
+			for (size_t off = 0; off < n; off += a->row_size) add_row(a, a->rowbuf + off);
+			continue;
+		}
+		if (closing) break;
+		while (sem_wait(&a->rows.items) < 0 && errno == EINTR) {}
+	}
+	return NULL;
+}
+
+static int init_streams(struct sc_analysis *a, struct sc_arena *ar) {
+	a->st = sc_arena_array(ar, a->nconns, sizeof(*a->st));
+	if (!a->st) return -1;
+	for (int i = 0; i < a->nconns; ++i) {
+		struct sc_analysis_stream *s = &a->st[i];
+		s->x = sc_arena_array(ar, a->len, sizeof(*s->x));
+		s->have = sc_arena_array(ar, a->len, sizeof(*s->have));
+		s->maxq = sc_arena_array(ar, a->len, sizeof(*s->maxq));
+		s->minq = sc_arena_array(ar, a->len, sizeof(*s->minq));
+		if (!s->x || !s->have || !s->maxq || !s->minq) return -1;
+		s->held = NAN;
+	}
+	a->re = sc_arena_array(ar, a->len, sizeof(double));
+	a->im = sc_arena_array(ar, a->len, sizeof(double));
+	a->mag = sc_arena_array(ar, a->len / 2 + 1, sizeof(double));
+	a->cosv = sc_arena_array(ar, a->len, sizeof(double));
+	a->sinv = sc_arena_array(ar, a->len / 2, sizeof(double));
+	if (!a->re || !a->im || !a->mag || !a->cosv || !a->sinv) return -1;
+	for (unsigned k = 0; k < a->len; ++k) {
+		double w = 2 * M_PI * k / a->len;
+		a->cosv[k] = cos(w);
+		if (k < a->len / 2) a->sinv[k] = -sin(w);
+	}
+	return 0;
+}
+
+int sc_analysis_init(struct sc_client *c, const struct sc_options *opts) {
+	if (!opts->analysis_ns) return 0;
+	if (opts->format != SC_OUT_JSON) {
+		fprintf(stderr, "sigclient: analysis records need JSON output\n");
+		errno = EINVAL;
+		return -1;
+	}
+	struct sc_analysis *a = sc_arena_alloc(c->arena, sizeof(*a), 64);
+	if (!a) return -1;
+	a->streams = c->streams;
+	a->nconns = c->nconns;
+	a->timestamp_us = c->timestamp_us;
+	a->len = opts->analysis_len ? opts->analysis_len : SC_ANALYSIS_LEN;
+	long long every = opts->analysis_ns / c->window_ns;
+	a->every = every < 1 ? 1 : every > UINT32_MAX ? UINT32_MAX : (unsigned)every;
+	a->fs = 1e9 / (double)c->window_ns;
+	a->row_size = sizeof(long long) + (size_t)c->nconns * sizeof(double);
+	a->line_max = sizeof("{\"timestamp_us\": , \"analysis\": {}}\n") + 24;
+	for (int i = 0; i < c->nconns; ++i)
+		a->line_max += strlen(c->streams[i].name) + sizeof(", \"\": {\"freq_hz\": , \"p2p\": , \"rms\": , "
+			"\"shape\": \"complex/unknown\", \"n\": 4294967295}") + 3 * 16;
+	a->rowbuf = sc_arena_alloc(c->arena, ROW_BATCH * a->row_size, 64);
+	a->line = sc_arena_alloc(c->arena, a->line_max, 64);
+	a->take = sc_arena_alloc(c->arena, a->line_max, 64);
+	if (!a->rowbuf || !a->line || !a->take || init_streams(a, c->arena) < 0) return -1;
+	if (sc_ring_init(&a->rows, c->arena, SC_ANALYSIS_ROWS, a->row_size, SC_RING_DROP_NEWEST) < 0) return -1;
+	if (sc_ring_init(&a->results, c->arena, SC_ANALYSIS_RESULTS, a->line_max, SC_RING_DROP_NEWEST) < 0) {
+		sc_ring_free(&a->rows);
+		return -1;
+	}
+	atomic_init(&a->closing, 0);
+	int err = pthread_create(&a->thread, NULL, analysis_main, a);
+	if (err) {
+		sc_ring_free(&a->rows);
+		sc_ring_free(&a->results);
+		errno = err;
+		return -1;
+	}
+	c->analysis = a;
+	return 0;
+}
+
+// Stop the thread once it has gone through the queued rows; lines it
+// encodes after the last tick are not written
+void sc_analysis_free(struct sc_client *c) {
+	struct sc_analysis *a = c->analysis;
+	if (!a) return;
+	atomic_store(&a->closing, 1);
+	sem_post(&a->rows.items);
+	pthread_join(a->thread, NULL);
+	if (a->rows.dropped_newest || a->results.dropped_newest)
+		fprintf(stderr, "sigclient: analysis: %lld windows and %lld records dropped while it fell behind\n",
+			a->rows.dropped_newest, a->results.dropped_newest);
+	sc_ring_free(&a->rows);
+	sc_ring_free(&a->results);
+	c->analysis = NULL;
+}
@@ -0,0 +1,137 @@
+// arena.c
+// Startup arena: everything a client needs for its whole run (tables,
+// receive buffers, aggregates, output and ring records, metrics, control
+// request slots) is carved out of a few large mappings while it starts,
+// then the arena is sealed and its size is the memory bound of the run.
+// Nothing is ever freed on its own; the mappings go in one piece when the
+// client is freed. Mappings are MAP_NORESERVE, so the pages a receive
+// buffer never grows into cost address space only.
+//
+// Objects that come and go with connections use a pool: a fixed number
+// of equal slots from the arena with an intrusive LIFO free list, so the
+// slot handed out next is the one most recently warm.
+
+#define _GNU_SOURCE     // MAP_NORESERVE
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sigclient.h"
+
+#define ARENA_BLOCK (256u << 10)    // mapping size unless an allocation needs more
+
+struct sc_arena_block {
+	struct sc_arena_block *next;
+	size_t size, used;
+};
+
+static size_t page_round(size_t n) {
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	return (n + page - 1) & ~(page - 1);
+}
+
+static struct sc_arena_block *map_block(size_t need) {
+	size_t size = page_round(need > ARENA_BLOCK ? need : ARENA_BLOCK);
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED) return NULL;
+	struct sc_arena_block *b = p;
+	b->next = NULL;
+	b->size = size;
+	b->used = sizeof(*b);
+	return b;
+}
+
+// The arena lives at the start of its own first mapping
+struct sc_arena *sc_arena_create(void) {
+	struct sc_arena_block *b = map_block(0);
+	if (!b) return NULL;
+	struct sc_arena *a = (struct sc_arena *)(b + 1);
+	b->used += sizeof(*a);
+	a->blocks = b;
+	a->mapped = b->size;
+	a->used = b->used;
+	a->sealed = 0;
+	return a;
+}
+
+void sc_arena_destroy(struct sc_arena *a) {
+	if (!a) return;
+	struct sc_arena_block *b = a->blocks;
+	while (b) {
+		struct sc_arena_block *next = b->next;
+		munmap(b, b->size);
+		b = next;
+	}
+}
+
+// n zeroed bytes aligned to align (a power of two). NULL with ENOMEM, or
+// EPERM once the arena is sealed.
+void *sc_arena_alloc(struct sc_arena *a, size_t n, size_t align) {
+	if (a->sealed) {
+		errno = EPERM;
+		return NULL;
+	}
+	if (align < sizeof(void *)) align = sizeof(void *);
+	struct sc_arena_block *b = a->blocks;
+	uintptr_t base = (uintptr_t)b;
+	size_t off = ((base + b->used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+	if (off + n > b->size) {
+		// the tail of the current block stays unused
+		b = map_block(sizeof(*b) + align + n);
+		if (!b) return NULL;
+		b->next = a->blocks;
+		a->blocks = b;
+		a->mapped += b->size;
+		base = (uintptr_t)b;
+		off = ((base + b->used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+	}
+	a->used += off + n - b->used;
+	b->used = off + n;
+	return (char *)b + off;
+}
+
+// count elements of size bytes, suitably aligned for any type
+void *sc_arena_array(struct sc_arena *a, size_t count, size_t size) {
+	if (size && count > SIZE_MAX / size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return sc_arena_alloc(a, count * size, _Alignof(max_align_t));
+}
+
+void sc_arena_seal(struct sc_arena *a) {
+	a->sealed = 1;
+}
+
+int sc_pool_init(struct sc_pool *p, struct sc_arena *a, size_t size, unsigned count, size_t align) {
+	memset(p, 0, sizeof(*p));
+	if (size < sizeof(void *)) size = sizeof(void *);
+	size = (size + align - 1) & ~(align - 1);
+	if (count && size > SIZE_MAX / count) {
+		errno = ENOMEM;
+		return -1;
+	}
+	p->base = sc_arena_alloc(a, size * count, align);
+	if (!p->base) return -1;
+	p->size = size;
+	p->count = count;
+	for (unsigned i = count; i-- > 0;) sc_pool_put(p, p->base + (size_t)i * size);
+	return 0;
+}
+
+// A free slot (not zeroed), NULL if all are taken
+void *sc_pool_get(struct sc_pool *p) {
+	char *obj = p->free;
+	if (!obj) return NULL;
+	memcpy(&p->free, obj, sizeof(p->free));
+	p->avail--;
+	return obj;
+}
+
+void sc_pool_put(struct sc_pool *p, void *obj) {
+	memcpy(obj, &p->free, sizeof(p->free));
+	p->free = obj;
+	p->avail++;
+}
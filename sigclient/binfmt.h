@@ -0,0 +1,81 @@
+// binfmt.h
+// Binary output format (-o bin). Everything is little-endian.
+//
+//   header   struct sc_bin_header, then ncols x struct sc_bin_column
+//   records  one per tick, record_size bytes each:
+//            struct sc_bin_record
+//            presence bitmap, bit k = column k has a value, padded to a
+//              multiple of 8 bytes
+//            ncols x float64, NaN where the presence bit is clear
+//
+// A plain stream is one column named after it; an aggregated stream has
+// one column per selected field, named "stream.field" (count included,
+// as a float64). analyzer/scbin.py reads this format.
+
+#ifndef SIGCLIENT_BINFMT_H
+#define SIGCLIENT_BINFMT_H
+
+#include <stdint.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "binary output assumes a little-endian host"
+#endif
+
+#define SC_BIN_MAGIC "SCB1"
+#define SC_BIN_VERSION 1
+#define SC_BIN_SYNC 0x31524353u     // "SCR1", starts every record
+#define SC_BIN_COLNAME_MAX 48
+
+struct sc_bin_header {
+	char magic[4];
+	uint16_t version;
+	uint16_t ncols;
+	uint32_t header_size;   // bytes, including the column table
+	uint32_t record_size;
+	int64_t window_ns;
+};
+
+struct sc_bin_column {
+	char name[SC_BIN_COLNAME_MAX];  // NUL-padded
+};
+
+struct sc_bin_record {
+	uint32_t sync;
+	uint32_t seq;           // window number since start; gaps are skipped windows
+	int64_t ts_ns;          // epoch ns of the tick
+};
+
+// Bytes of the presence bitmap for ncols columns
+#define SC_BIN_BITMAP_SIZE(ncols) ((((ncols) + 63) / 64) * 8)
+#define SC_BIN_RECORD_SIZE(ncols) \
+	(sizeof(struct sc_bin_record) + SC_BIN_BITMAP_SIZE(ncols) + 8 * (size_t)(ncols))
+
+// Capture directories (-C): segment files plus one index.
+//
+//   seg-NNNNNN.scb  a complete binary stream (header + records), written
+//                   through a preallocated mmap; trimmed to its used size
+//                   when closed, so the open segment may end in zeros
+//   index           struct sc_cap_index_header, then one entry per
+//                   segment; the open segment's entry is updated after
+//                   every record, so readers can trust `records`
+#define SC_CAP_INDEX_MAGIC "SCIX"
+#define SC_CAP_INDEX_VERSION 1
+#define SC_CAP_INDEX_NAME "index"
+#define SC_CAP_SEGMENT_FMT "seg-%06u.scb"
+
+struct sc_cap_index_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;         // entries in use
+	uint32_t capacity;      // entries the file has room for
+};
+
+struct sc_cap_index_entry {
+	uint32_t segment;       // NNNNNN in the file name
+	uint32_t open;          // 1 while being written
+	int64_t first_ns;       // timestamp of the first record
+	int64_t last_ns;        // timestamp of the last record
+	uint64_t records;
+};
+
+#endif
@@ -0,0 +1,196 @@
+// capture.c
+// Capture mode (-C dir): binary records go straight into memory-mapped
+// segment files instead of stdout. Each segment is preallocated with
+// posix_fallocate (so a full disk fails at rotation, not as SIGBUS on a
+// page fault mid-write), starts with its own schema header and is rotated
+// by size or by time. An mmapped index keeps the first/last timestamp
+// and record count of every segment, updated after each record, so a
+// reader can pick the segments of a time range and binary-search the
+// fixed-size records inside them without scanning anything.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sigclient.h"
+#include "binfmt.h"
+
+#define INDEX_GROW 1024
+#define PATH_LEN 4096
+
+static struct sc_cap_index_header *index_header(const struct sc_capture *cp) {
+	return (struct sc_cap_index_header *)cp->idx;
+}
+
+static struct sc_cap_index_entry *index_entry(const struct sc_capture *cp, uint32_t i) {
+	return (struct sc_cap_index_entry *)(cp->idx + sizeof(struct sc_cap_index_header)) + i;
+}
+
+// (Re)map the index with room for capacity entries
+static int map_index(struct sc_capture *cp, uint32_t capacity) {
+	size_t size = sizeof(struct sc_cap_index_header) + (size_t)capacity * sizeof(struct sc_cap_index_entry);
+	if (ftruncate(cp->idx_fd, (off_t)size) < 0) return -1;
+	void *m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, cp->idx_fd, 0);
+	if (m == MAP_FAILED) return -1;
+	if (cp->idx) munmap(cp->idx, cp->idx_size);
+	cp->idx = m;
+	cp->idx_size = size;
+	index_header(cp)->capacity = capacity;
+	return 0;
+}
+
+// Open the directory's index, continuing an existing one
+static int open_index(struct sc_capture *cp) {
+	char path[PATH_LEN];
+	snprintf(path, sizeof(path), "%s/%s", cp->dir, SC_CAP_INDEX_NAME);
+	cp->idx_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (cp->idx_fd < 0) return -1;
+
+	struct stat st;
+	if (fstat(cp->idx_fd, &st) < 0) return -1;
+	struct sc_cap_index_header h;
+	if ((size_t)st.st_size >= sizeof(h) && pread(cp->idx_fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+	    memcmp(h.magic, SC_CAP_INDEX_MAGIC, 4) == 0 && h.version == SC_CAP_INDEX_VERSION &&
+	    h.count <= h.capacity && (size_t)st.st_size >= sizeof(h) + (size_t)h.capacity * sizeof(struct sc_cap_index_entry)) {
+		if (map_index(cp, h.capacity) < 0) return -1;
+		// a previous run that did not shut down cleanly
+		if (h.count) index_entry(cp, h.count - 1)->open = 0;
+		return 0;
+	}
+	if (st.st_size != 0) {
+		fprintf(stderr, "sigclient: %s is not a capture index\n", path);
+		errno = EINVAL;
+		return -1;
+	}
+	if (map_index(cp, INDEX_GROW) < 0) return -1;
+	struct sc_cap_index_header *nh = index_header(cp);
+	memcpy(nh->magic, SC_CAP_INDEX_MAGIC, 4);
+	nh->version = SC_CAP_INDEX_VERSION;
+	nh->count = 0;
+	return 0;
+}
+
+static int open_segment(struct sc_capture *cp, long long ts_ns) {
+	struct sc_cap_index_header *h = index_header(cp);
+	if (h->count == h->capacity && map_index(cp, h->capacity + INDEX_GROW) < 0) return -1;
+	h = index_header(cp);
+	uint32_t no = h->count ? index_entry(cp, h->count - 1)->segment + 1 : 1;
+
+	char path[PATH_LEN];
+	snprintf(path, sizeof(path), "%s/" SC_CAP_SEGMENT_FMT, cp->dir, no);
+	int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return -1;
+	int err = posix_fallocate(fd, 0, (off_t)cp->seg_size);
+	if (err == EINVAL || err == EOPNOTSUPP) err = ftruncate(fd, (off_t)cp->seg_size) < 0 ? errno : 0;
+	void *m = err ? MAP_FAILED : mmap(NULL, cp->seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED) {
+		if (!err) err = errno;
+		close(fd);
+		unlink(path);
+		errno = err;
+		return -1;
+	}
+	cp->seg_fd = fd;
+	cp->seg = m;
+	memcpy(cp->seg, cp->header, cp->header_len);
+	cp->seg_len = cp->header_len;
+
+	struct sc_cap_index_entry *e = index_entry(cp, h->count);
+	e->segment = no;
+	e->open = 1;
+	e->first_ns = e->last_ns = ts_ns;
+	e->records = 0;
+	h->count++;
+	return 0;
+}
+
+// Unmap the open segment and trim it to the records written
+static void close_segment(struct sc_capture *cp) {
+	if (!cp->seg) return;
+	munmap(cp->seg, cp->seg_size);
+	if (ftruncate(cp->seg_fd, (off_t)cp->seg_len) < 0)
+		fprintf(stderr, "sigclient: trimming capture segment: %s\n", strerror(errno));
+	close(cp->seg_fd);
+	cp->seg = NULL;
+	cp->seg_fd = -1;
+	index_entry(cp, index_header(cp)->count - 1)->open = 0;
+}
+
+// max_bytes caps each segment (default SC_CAPTURE_SEGMENT), max_ns
+// rotates after that much time (0 = size only)
+int sc_capture_open(struct sc_capture *cp, const char *dir, const char *header, size_t header_len,
+		size_t record_size, long long max_bytes, long long max_ns) {
+	memset(cp, 0, sizeof(*cp));
+	cp->seg_fd = cp->idx_fd = -1;
+	cp->record_size = record_size;
+	cp->max_ns = max_ns;
+	if (max_bytes <= 0) max_bytes = SC_CAPTURE_SEGMENT;
+	if ((size_t)max_bytes < header_len + record_size) {
+		errno = EINVAL;
+		return -1;
+	}
+	cp->seg_size = header_len + ((size_t)max_bytes - header_len) / record_size * record_size;
+
+	cp->dir = strdup(dir);
+	cp->header = malloc(header_len);
+	if (!cp->dir || !cp->header) {
+		sc_capture_close(cp);
+		return -1;
+	}
+	memcpy(cp->header, header, header_len);
+	cp->header_len = header_len;
+	if ((mkdir(dir, 0755) < 0 && errno != EEXIST) || open_index(cp) < 0) {
+		int err = errno;
+		fprintf(stderr, "sigclient: capture %s: %s\n", dir, strerror(err));
+		sc_capture_close(cp);
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+void sc_capture_close(struct sc_capture *cp) {
+	close_segment(cp);
+	if (cp->idx) munmap(cp->idx, cp->idx_size);
+	if (cp->idx_fd >= 0) close(cp->idx_fd);
+	free(cp->dir);
+	free(cp->header);
+	memset(cp, 0, sizeof(*cp));
+	cp->seg_fd = cp->idx_fd = -1;
+}
+
+// Room for the record of tick ts_ns, rotating first if the segment is
+// full or old enough. NULL if no segment could be opened (reported once;
+// the record is dropped and the next tick tries again).
+char *sc_capture_reserve(struct sc_capture *cp, long long ts_ns) {
+	if (cp->seg) {
+		const struct sc_cap_index_entry *e = index_entry(cp, index_header(cp)->count - 1);
+		if (cp->seg_len + cp->record_size > cp->seg_size ||
+		    (cp->max_ns && e->records && ts_ns - e->first_ns >= cp->max_ns))
+			close_segment(cp);
+	}
+	if (!cp->seg && open_segment(cp, ts_ns) < 0) {
+		if (!cp->failed) fprintf(stderr, "sigclient: capture segment in %s: %s\n", cp->dir, strerror(errno));
+		cp->failed = 1;
+		return NULL;
+	}
+	cp->failed = 0;
+	return cp->seg + cp->seg_len;
+}
+
+// Account for the record written at the reserved position
+void sc_capture_commit(struct sc_capture *cp, long long ts_ns) {
+	struct sc_cap_index_entry *e = index_entry(cp, index_header(cp)->count - 1);
+	cp->seg_len += cp->record_size;
+	if (e->records == 0) e->first_ns = ts_ns;
+	e->last_ns = ts_ns;
+	// publish the count last so a concurrent reader never sees a record
+	// it cannot read yet
+	__atomic_store_n(&e->records, e->records + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,596 @@
+// client.c
+// Main ingest loop: reconnects, waits on the event backend for readable
+// sockets and fires the tick callback on every window boundary.
+//
+// Spin mode (-S) trades a core for wake-up latency: while events keep
+// arriving, and from idle_ns before each tick, the loop polls the backend
+// with a zero timeout and fires the tick from its own clock reads rather
+// than waiting for the timerfd. After idle_ns without events it goes back
+// to blocking waits. Stream sockets also get SO_BUSY_POLL so the kernel
+// polls the device queue on empty reads.
+
+#define _GNU_SOURCE     // SO_BUSY_POLL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "sigclient.h"
+#include "scan.h"
+
+#define EV_BATCH 64
+#define RECV_BUFS_PER_CONN 4    // io_uring provided buffers
+
+// Tables for streams [first, first + n) of opts. A loop that reads them
+// gets an SC_BUF_MAX receive buffer slot per stream, of which only what a
+// buffer grows into is committed (see conn.c); the merged view of the
+// shards only ever holds a value.
+static int init_tables(struct sc_client *c, const struct sc_options *opts, int first, int n, int reads) {
+	// -A: per-stream arrival state and a second set of statistics for
+	// the window after the open one
+	int arrival = reads && opts->arrival != SC_ARRIVAL_OFF;
+	c->conns = sc_arena_array(c->arena, n, sizeof(*c->conns));
+	c->streams = sc_arena_array(c->arena, n, sizeof(*c->streams));
+	c->stats = sc_arena_array(c->arena, arrival ? 2 * n : n, sizeof(*c->stats));
+	if (!c->conns || !c->streams || !c->stats) return -1;
+	if (arrival && !(c->arrival_conns = sc_arena_array(c->arena, n, sizeof(*c->arrival_conns)))) return -1;
+	if (reads && sc_pool_init(&c->bufs, c->arena, SC_BUF_MAX, (unsigned)n, (size_t)sysconf(_SC_PAGESIZE)) < 0) return -1;
+
+	for (int i = 0; i < n; ++i) {
+		const struct sc_stream_spec *sp = &opts->streams[first + i];
+		struct sc_stream *s = &c->streams[i];
+		snprintf(s->name, sizeof(s->name), "%s", sp->name);
+		int rc = reads ? sc_stream_resolve(s, sp->host, sp->port) : 0;
+		if (rc != 0) {
+			fprintf(stderr, "sigclient: %s: cannot resolve '%s': %s\n", sp->name, sp->host,
+				rc == EAI_SYSTEM ? strerror(errno) : gai_strerror(rc));
+			c->nconns = i;     // the ones resolved so far are freed
+			errno = EINVAL;
+			return -1;
+		}
+		s->sock = sp->sock_set ? sp->sock : opts->sock;
+		char *buf = reads ? sc_pool_get(&c->bufs) : sc_arena_alloc(c->arena, SC_TOKEN_MAX, 64);
+		if (!buf) {
+			sc_stream_resolve_free(s);
+			c->nconns = i;
+			return -1;
+		}
+		sc_conn_init(&c->conns[i], s, buf);
+		c->conns[i].numeric = opts->numeric || opts->format == SC_OUT_BIN || opts->analysis_ns;
+		s->agg = sp->agg_set ? sp->agg : opts->agg;
+		if (s->agg) c->conns[i].stats = &c->stats[i];
+		if (arrival) {
+			struct sc_arrival_conn *a = &c->arrival_conns[i];
+			a->clock = &c->arrival;
+			if (s->agg) a->next_stats = &c->stats[n + i];
+			c->conns[i].arrival = a;
+		}
+	}
+	if (arrival) {
+		c->arrival.mode = opts->arrival;
+		c->arrival.interp = opts->interp;
+	}
+	c->nconns = n;
+	return 0;
+}
+
+// poll() is the portable fallback when the requested backend is missing
+static struct sc_evloop *create_backend(enum sc_ev_backend backend, int nfds) {
+	struct sc_evloop *ev = sc_ev_create(backend, nfds);
+	if (!ev && backend != SC_EV_POLL) {
+		fprintf(stderr, "sigclient: %s backend unavailable (%s), using poll\n",
+			sc_ev_backend_name(backend), strerror(errno));
+		ev = sc_ev_create(SC_EV_POLL, nfds);
+	}
+	return ev;
+}
+
+// Connections, buffers and event backend for streams [first, first + n)
+static int init_loop(struct sc_client *c, const struct sc_options *opts, int first, int n) {
+	if (init_tables(c, opts, first, n, 1) < 0) return -1;
+	c->ev = create_backend(opts->backend, c->nconns + 2);  // + timerfd, watch
+	if (!c->ev) return -1;
+
+	// io_uring: one multishot recv per socket into provided buffers, or
+	// on kernels without that, reads straight into the registered slab
+	// (which pins all of it)
+	if (sc_ev_can_read(c->ev)) {
+		unsigned nbufs = 16;
+		while (nbufs < (unsigned)c->nconns * RECV_BUFS_PER_CONN && nbufs < 4096) nbufs <<= 1;
+		c->multishot = sc_ev_provide_buffers(c->ev, nbufs, SC_RECV_BUF_SIZE) == 0;
+		if (!c->multishot) {
+			struct iovec iov = { c->bufs.base, c->bufs.size * c->bufs.count };
+			c->fixed_bufs = sc_ev_register_buffers(c->ev, &iov, 1) == 0;
+		}
+	}
+
+	c->watch.fd = -1;
+	c->spin.idle_ns = opts->spin_idle_ns;
+	c->spin.busy_poll_us = opts->busy_poll_us;
+	c->spin.cpu = -1;
+	c->next_connect_due = 0;    // connect everything on the first pass
+	c->rng = ((unsigned long long)sc_epoch_ms_now() ^ (unsigned long long)first) * 0x9e3779b97f4a7c15ULL | 1;
+	return 0;
+}
+
+// window_ns is the client's default window, used unless -w was given
+int sc_client_init(struct sc_client *c, const struct sc_options *opts, long long window_ns) {
+	memset(c, 0, sizeof(*c));
+	c->window_ns = opts->window_ns ? opts->window_ns : window_ns;
+	c->timestamp_us = opts->timestamp_us;
+	if (c->window_ns % SC_NS_PER_MS && !c->timestamp_us)
+		fprintf(stderr, "sigclient: window is not a whole number of ms, consider -u for us timestamps\n");
+	c->numeric = opts->numeric;
+	c->lateness = opts->lateness;
+	sc_scan_init();
+	c->arena = sc_arena_create();
+	if (!c->arena) return -1;
+	c->owns_arena = 1;
+
+	int rc;
+	if (opts->shards) {
+		// the workers own the sockets; this loop only ticks and merges
+		rc = init_tables(c, opts, 0, opts->nstreams, 0);
+		if (rc == 0) rc = (c->ev = create_backend(opts->backend, 2)) ? 0 : -1;
+		if (rc == 0) rc = sc_shards_init(c, opts);
+		c->next_connect_due = LLONG_MAX;
+		c->watch.fd = -1;
+	} else {
+		rc = init_loop(c, opts, 0, opts->nstreams);
+	}
+	// a spinning tick loop gets the core after the shards' (see shard.c)
+	c->spin.idle_ns = opts->spin_idle_ns;
+	c->spin.cpu = c->spin.idle_ns ? sc_cpu_nth(c->nshards) : -1;
+	if (rc < 0 || sc_analysis_init(c, opts) < 0 || sc_out_init(&c->out, c, opts) < 0 || sc_metrics_init(c, opts) < 0) {
+		int err = errno;
+		sc_client_free(c);
+		errno = err;
+		return -1;
+	}
+
+	// first tick on the next window boundary; without a timerfd the loop
+	// falls back to wait timeouts
+	sc_sched_init(&c->sched, c->window_ns);
+	if (c->sched.fd >= 0 && sc_ev_add(c->ev, c->sched.fd, SC_EV_IN, &c->sched) < 0) sc_sched_free(&c->sched);
+	return 0;
+}
+
+// Loop-only client for streams [first, first + n) of opts: no output and
+// no timer of its own yet (shard workers, see shard.c). Its memory comes
+// from arena, which stays the caller's.
+int sc_client_init_slice(struct sc_client *c, const struct sc_options *opts, long long window_ns, int first, int n,
+		struct sc_arena *arena) {
+	memset(c, 0, sizeof(*c));
+	c->arena = arena;
+	c->window_ns = window_ns;
+	c->base = first;
+	c->sched.fd = -1;
+	c->out.fd = -1;
+	atomic_init(&c->stopping, 0);
+	if (init_loop(c, opts, first, n) < 0) {
+		sc_client_free(c);
+		return -1;
+	}
+	return 0;
+}
+
+void sc_client_free(struct sc_client *c) {
+	for (int i = 0; i < c->nconns && c->conns; ++i) {
+		sc_conn_close(&c->conns[i]);
+		sc_stream_resolve_free(&c->streams[i]);
+	}
+	sc_metrics_free(c);
+	sc_shards_free(c);
+	sc_ev_destroy(c->ev);
+	sc_sched_free(&c->sched);
+	sc_analysis_free(c);
+	sc_out_free(&c->out);
+	if (c->owns_arena) sc_arena_destroy(c->arena);
+	memset(c, 0, sizeof(*c));
+}
+
+// Index of the stream with the given output name, -1 if not configured
+int sc_client_find(const struct sc_client *c, const char *name) {
+	for (int i = 0; i < c->nconns; ++i)
+		if (strcmp(c->streams[i].name, name) == 0) return i;
+	return -1;
+}
+
+// Latest value of stream i in the current window, "--" if none
+const char *sc_client_value(const struct sc_client *c, int i) {
+	const char *v = sc_conn_value(&c->conns[i]);
+	return v ? v : "--";
+}
+
+// Parse stream i's values on arrival (always on with -n) so that
+// sc_client_number works for it
+void sc_client_set_numeric(struct sc_client *c, int i) {
+	c->conns[i].numeric = 1;
+	for (int k = 0; k < c->nshards; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		if (i >= sh->first && i < sh->first + sh->client.nconns) sh->client.conns[i - sh->first].numeric = 1;
+	}
+}
+
+// Parsed value of stream i in the current window, SC_ABSENT if none
+double sc_client_number(const struct sc_client *c, int i) {
+	return sc_conn_number(&c->conns[i]);
+}
+
+// Monotonic time the current window's value of stream i was received
+long long sc_client_value_ns(const struct sc_client *c, int i) {
+	return c->conns[i].value_ns;
+}
+
+// Call fn with each value stream i receives, parsed, as soon as it
+// arrives. One hook per client; it runs on the thread that owns the
+// stream, i.e. a shard worker with -j.
+void sc_client_notify(struct sc_client *c, int i, sc_sample_fn fn, void *arg) {
+	sc_client_set_numeric(c, i);
+	c->on_sample = fn;
+	c->sample_arg = arg;
+	c->conns[i].notify = 1;
+	for (int k = 0; k < c->nshards; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		if (i >= sh->first && i < sh->first + sh->client.nconns) {
+			sh->client.on_sample = fn;
+			sh->client.sample_arg = arg;
+			sh->client.conns[i - sh->first].notify = 1;
+		}
+	}
+}
+
+// Serve fd (non-blocking, read interest) from the loop that owns stream
+// owner, or from the tick loop if owner is -1: fn runs when it is
+// readable or the deadline it returned passes, on that loop's thread.
+// fn must read until EAGAIN (the epoll backend is edge-triggered). One
+// watch per loop. Returns 0, or -1 (errno set).
+int sc_client_watch(struct sc_client *c, int owner, int fd, sc_watch_fn fn, void *arg) {
+	struct sc_client *loop = c;
+	for (int k = 0; k < c->nshards && owner >= 0; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		if (owner >= sh->first && owner < sh->first + sh->client.nconns) loop = &sh->client;
+	}
+	if (loop->watch.fd >= 0) {
+		errno = EBUSY;
+		return -1;
+	}
+	if (sc_set_nonblocking(fd) < 0 || sc_ev_add(loop->ev, fd, SC_EV_IN, &loop->watch) < 0) return -1;
+	loop->watch.fd = fd;
+	loop->watch.fn = fn;
+	loop->watch.arg = arg;
+	loop->watch.due_ns = 0;
+	return 0;
+}
+
+// Set the watch deadline from a callback running on its loop (e.g. after
+// sending a request from on_tick or on_sample); 0 clears it
+void sc_client_watch_due(struct sc_client *c, long long due_ns) {
+	c->watch.due_ns = due_ns;
+}
+
+static void run_watch(struct sc_client *c, int readable, long long now_ns) {
+	c->watch.due_ns = c->watch.fn(c, readable, now_ns, c->watch.arg);
+}
+
+// Close and schedule a reconnect with backoff. A named host is looked up
+// again meanwhile, in case the server moved.
+static void conn_drop(struct sc_client *c, struct sc_conn *conn, long long now) {
+	struct sc_stream *s = &c->streams[conn - c->conns];
+	if (conn->fd >= 0) sc_ev_del(c->ev, conn->fd);
+	if (conn->metrics) conn->metrics->drops++;
+	sc_stream_refresh(s);
+	sc_conn_retry_later(conn, s, now, &c->rng);
+	if (s->next_try < c->next_connect_due) c->next_connect_due = s->next_try;
+}
+
+// Queue the next completion read: the multishot recv that serves the
+// whole connection, or a read into the free tail of inbuf
+static int arm_read(struct sc_client *c, struct sc_conn *conn) {
+	if (c->multishot) return sc_ev_recv(c->ev, conn->fd);
+	int room = sc_conn_reserve(conn);
+	return sc_ev_read(c->ev, conn->fd, conn->inbuf + conn->inlen, room, c->fixed_bufs ? 0 : -1);
+}
+
+// Switch a freshly connected socket from connect to read interest
+static int conn_up(struct sc_client *c, struct sc_conn *conn, int registered) {
+	if (conn->metrics) conn->metrics->connects++;
+	if (sc_ev_can_read(c->ev)) {
+		if (registered ? sc_ev_mod(c->ev, conn->fd, 0, conn) : sc_ev_add(c->ev, conn->fd, 0, conn)) return -1;
+		return arm_read(c, conn);
+	}
+	if (registered) return sc_ev_mod(c->ev, conn->fd, SC_EV_IN, conn);
+	return sc_ev_add(c->ev, conn->fd, SC_EV_IN, conn);
+}
+
+// Let empty reads busy-poll the device queue (-S busy=)
+static void set_busy_poll(struct sc_client *c, int fd) {
+#ifdef SO_BUSY_POLL
+	int us = c->spin.busy_poll_us;
+	if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &us, sizeof(us)) == 0 || c->spin.busy_poll_failed++) return;
+	fprintf(stderr, "sigclient: SO_BUSY_POLL %d us: %s\n", us, strerror(errno));
+#else
+	(void)fd;
+	if (!c->spin.busy_poll_failed++) fprintf(stderr, "sigclient: SO_BUSY_POLL not supported here\n");
+#endif
+}
+
+static void conn_open(struct sc_client *c, struct sc_conn *conn, long long now) {
+	struct sc_stream *s = &c->streams[conn - c->conns];
+	if (!conn->inbuf) {
+		conn->inbuf = sc_pool_get(&c->bufs);    // one slot per stream, never empty
+		if (conn->metrics) conn->metrics->inbuf = (uint64_t)conn->cap;
+	}
+	int rc = sc_conn_start(conn, s, now);
+	if (rc >= 0 && c->spin.busy_poll_us) set_busy_poll(c, conn->fd);
+	if (rc == 1) rc = conn_up(c, conn, 0);
+	else if (rc == 0) rc = sc_ev_add(c->ev, conn->fd, SC_EV_OUT, conn);
+	if (rc < 0) conn_drop(c, conn, now);
+}
+
+// Start due connects and expire stalled ones. All attempts run in
+// parallel; nothing here blocks. Skipped until the earliest deadline.
+static void reconnect_pass(struct sc_client *c, long long now) {
+	if (now < c->next_connect_due) return;
+	long long due = now + SC_MAX_WAIT_MS;
+	for (int i = 0; i < c->nconns; ++i) {
+		struct sc_conn *conn = &c->conns[i];
+		struct sc_stream *s = &c->streams[i];
+		if (conn->state == SC_CONN_IDLE && now >= s->next_try) {
+			sc_stream_poll_resolve(s);
+			conn_open(c, conn, now);
+		}
+		else if (conn->state == SC_CONN_CONNECTING && now - s->connect_started >= SC_CONNECT_TIMEOUT_MS)
+			conn_drop(c, conn, now);
+
+		if (conn->state == SC_CONN_IDLE && s->next_try < due) due = s->next_try;
+		else if (conn->state == SC_CONN_CONNECTING && s->connect_started + SC_CONNECT_TIMEOUT_MS < due)
+			due = s->connect_started + SC_CONNECT_TIMEOUT_MS;
+	}
+	c->next_connect_due = due;
+}
+
+// Run the arrival hook for the newest value of this read, which with -A
+// may already belong to the next window (and carries its own stamp)
+static void conn_arrived(struct sc_client *c, struct sc_conn *conn, long long now_ns) {
+	conn->fresh = 0;
+	struct sc_arrival_conn *a = conn->arrival;
+	if (!a) conn->value_ns = now_ns;
+	if (!conn->notify) return;
+	int next = a && a->next_have;
+	c->on_sample(c, c->base + (int)(conn - c->conns), next ? a->next_value : sc_conn_number(conn),
+		next ? a->next_ns : conn->value_ns, c->sample_arg);
+}
+
+static void handle_event(struct sc_client *c, const struct sc_event *e, long long now_ns) {
+	long long now = now_ns / 1000000LL;
+	struct sc_conn *conn = e->data;
+	struct sc_stream *s = &c->streams[conn - c->conns];
+	if (conn->fd < 0) {
+		if (e->events & SC_EV_RECV) sc_ev_recv_done(c->ev, e);
+		return;
+	}
+	if (conn->arrival) conn->arrival->rx_ns = now_ns;
+	if (conn->state == SC_CONN_CONNECTING) {
+		if (!(e->events & (SC_EV_OUT | SC_EV_ERR))) return;
+		if (sc_conn_finish(conn, s) < 0 || conn_up(c, conn, 1) < 0) conn_drop(c, conn, now);
+		return;
+	}
+	if (e->events & SC_EV_RECV) {
+		sc_conn_copy_in(conn, e->buf, (size_t)e->res);
+		sc_ev_recv_done(c->ev, e);
+		if (conn->fresh) conn_arrived(c, conn, now_ns);
+	} else if (e->events & SC_EV_READ) {
+		if (e->res > 0) {
+			// the read was armed for the whole free tail
+			int full = conn->inlen + e->res == conn->cap;
+			sc_conn_feed(conn, e->res);
+			sc_conn_count_read(conn, (size_t)e->res, full);
+			if (conn->fresh) conn_arrived(c, conn, now_ns);
+			if (arm_read(c, conn) < 0) conn_drop(c, conn, now);
+		} else if (e->res == -EAGAIN || e->res == -EINTR || (e->res == -EINVAL && c->multishot)) {
+			// -EINVAL: a kernel with buffer rings but no multishot recv
+			if (e->res == -EINVAL) c->multishot = 0;
+			if (arm_read(c, conn) < 0) conn_drop(c, conn, now);
+		} else {
+			// remote closed or error
+			conn_drop(c, conn, now);
+		}
+	} else if (e->events & SC_EV_IN) {
+		int rc = sc_conn_read(conn);
+		if (conn->fresh) conn_arrived(c, conn, now_ns);
+		if (rc < 0) conn_drop(c, conn, now);
+	} else if (e->events & SC_EV_ERR) {
+		conn_drop(c, conn, now);
+	}
+	// quick-ack mode does not stick: re-enter it after every read
+	if ((s->sock.flags & SC_SOCK_QUICKACK) && conn->fd >= 0) sc_conn_quickack(conn);
+}
+
+static volatile sig_atomic_t stop_requested;
+
+static void on_stop_signal(int sig) {
+	(void)sig;
+	stop_requested = 1;
+}
+
+// Make SIGINT/SIGTERM end sc_client_run cleanly (buffered output is
+// flushed) instead of killing the process mid-batch
+void sc_client_stop_on_signals(void) {
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_stop_signal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;    // no SA_RESTART: interrupt the wait
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+}
+
+// Wall clock - monotonic clock now, to convert kernel receive stamps
+static long long realtime_offset(void) {
+	struct timespec rt, mt;
+	clock_gettime(CLOCK_REALTIME, &rt);
+	clock_gettime(CLOCK_MONOTONIC, &mt);
+	return (long long)(rt.tv_sec - mt.tv_sec) * 1000000000LL + (rt.tv_nsec - mt.tv_nsec);
+}
+
+static int run_loop(struct sc_client *c, sc_tick_fn on_tick, void *arg) {
+	struct sc_event evs[EV_BATCH];
+	c->arrival.close_ns = c->sched.next_ns;
+	c->arrival.rt_off_ns = realtime_offset();
+	while (!stop_requested && !atomic_load_explicit(&c->stopping, memory_order_relaxed)) {
+		long long now_ns = sc_mono_ns();
+		long long now = now_ns / 1000000LL;
+		reconnect_pass(c, now);
+
+		// wake for the next reconnect deadline, or the next tick when
+		// there is no timerfd to do that
+		long long timeout = c->next_connect_due - now;
+		long long tick_ms = sc_sched_timeout_ms(&c->sched, now_ns);
+		if (tick_ms >= 0 && tick_ms < timeout) timeout = tick_ms;
+		if (timeout < 0) timeout = 0;
+		if (c->watch.due_ns) {
+			long long d = c->watch.due_ns - now_ns;
+			long long watch_ms = d <= 0 ? 0 : (d + 999999) / 1000000;
+			if (watch_ms < timeout) timeout = watch_ms;
+		}
+		if (timeout > SC_MAX_WAIT_MS) timeout = SC_MAX_WAIT_MS; // safety
+
+		int spun = 0;
+		if (c->spin.idle_ns) {
+			long long to_tick = c->sched.next_ns - c->spin.idle_ns - now_ns;
+			if (now_ns - c->spin.last_event_ns < c->spin.idle_ns || to_tick <= 0) {
+				timeout = 0;
+				spun = 1;
+				c->spin.polls++;
+			} else {
+				// sleep, but wake early enough to spin into the tick
+				if (to_tick / 1000000 < timeout) timeout = to_tick / 1000000;
+				c->spin.blocks++;
+			}
+		}
+
+		int n = sc_ev_wait(c->ev, evs, EV_BATCH, (int)timeout);
+		if (n < 0) return -1;
+		now_ns = sc_mono_ns();
+		if (n > 0) c->spin.last_event_ns = now_ns;
+		else if (spun) c->spin.empty++;
+		struct sc_metrics *m = c->metrics;
+		if (m) m->loop.wakeups++;
+		for (int k = 0; k < n; ++k) {
+			if (evs[k].data == &c->sched) {
+				sc_sched_clear(&c->sched);
+			} else if (evs[k].data == &c->watch) {
+				run_watch(c, 1, now_ns);
+			} else if (!m) {
+				handle_event(c, &evs[k], now_ns);
+			} else {
+				long long t0 = sc_mono_ns();
+				handle_event(c, &evs[k], now_ns);
+				sc_hist_add(&m->loop.hist[SC_HIST_PARSE], sc_mono_ns() - t0);
+				m->loop.events++;
+			}
+		}
+		if (c->watch.due_ns && now_ns >= c->watch.due_ns) run_watch(c, 0, now_ns);
+
+		// Check if it's time to emit (timer fired, or a wait ran long)
+		now_ns = sc_mono_ns();
+		if (now_ns >= c->sched.next_ns) {
+			sc_sched_fire(&c->sched, now_ns);
+			if (m) sc_hist_add(&m->loop.hist[SC_HIST_LATE], c->sched.late_last_ns);
+			if (c->nshards) sc_shards_merge(c);
+			if (c->arrival.interp)
+				for (int i = 0; i < c->nconns; ++i) sc_conn_align(&c->conns[i], c->sched.next_ns);
+			// Use the scheduled tick time so timestamps align to window
+			// boundaries instead of the actual (slightly delayed) current time.
+			on_tick(c, c->sched.next_epoch_ns, arg);
+
+			// reset window flags and statistics; buffers may shrink
+			// unless completion reads own their tails
+			int adapt = !sc_ev_can_read(c->ev) || c->multishot;
+			for (int i = 0; i < c->nconns; ++i) {
+				struct sc_conn *conn = &c->conns[i];
+				if (adapt) sc_conn_adapt(conn, now_ns / 1000000LL);
+				if (conn->metrics) {
+					conn->metrics->windows++;
+					conn->metrics->absent += !conn->have;
+				}
+				if (conn->arrival) {
+					sc_conn_next_window(conn);
+				} else {
+					conn->have = 0;
+					if (conn->stats) sc_stats_reset(conn->stats);
+				}
+				// a stream that is down gives its buffer back until it reconnects
+				if (adapt && conn->state == SC_CONN_IDLE && conn->inbuf && !conn->have && c->bufs.base)
+					sc_pool_put(&c->bufs, sc_conn_release(conn));
+			}
+
+			// advance by whole windows to catch up if delayed
+			if (sc_sched_advance(&c->sched, now_ns) < 0) {
+				sc_ev_del(c->ev, c->sched.fd);
+				sc_sched_free(&c->sched);
+			}
+			c->arrival.close_ns = c->sched.next_ns;
+			if (c->arrival.mode == SC_ARRIVAL_KERNEL) c->arrival.rt_off_ns = realtime_offset();
+			if (m && now_ns >= m->next_ns) sc_metrics_snapshot(c, now_ns);
+		}
+	}
+	return 0;
+}
+
+static long long thread_cpu_ns(void) {
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0) return 0;
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// What the loop thread cost against what its ticks got (spin mode, or
+// -l as the blocking baseline to compare with)
+static void report_loop(const struct sc_client *c, long long wall_ns, long long cpu_ns) {
+	if (wall_ns <= 0 || c->nconns == 0) return;
+	const struct sc_sched *t = &c->sched;
+	fprintf(stderr, "sigclient: loop %s..%s: %.1f%% of a core over %.1f s", c->streams[0].name,
+		c->streams[c->nconns - 1].name, 100.0 * (double)cpu_ns / (double)wall_ns, (double)wall_ns / 1e9);
+	if (c->spin.idle_ns)
+		fprintf(stderr, ", %lld polls (%.1f%% empty), %lld blocking waits", c->spin.polls,
+			c->spin.polls ? 100.0 * (double)c->spin.empty / (double)c->spin.polls : 0.0, c->spin.blocks);
+	if (t->ticks)
+		fprintf(stderr, ", tick late us mean %.1f max %.1f",
+			(double)t->late_sum_ns / (double)t->ticks / 1e3, (double)t->late_max_ns / 1e3);
+	fputc('\n', stderr);
+}
+
+// Nothing is allocated past this point, so what the arena mapped is the
+// memory bound of the run (reported with -M)
+static void seal_arena(struct sc_client *c) {
+	sc_arena_seal(c->arena);
+	if (!c->metrics) return;
+	size_t bufs = (size_t)c->bufs.count * c->bufs.size;
+	for (int k = 0; k < c->nshards; ++k) bufs += (size_t)c->shards[k].client.bufs.count * c->shards[k].client.bufs.size;
+	fprintf(stderr, "sigclient: memory: %zu KB for %d streams, %zu KB of it receive buffer slots (committed as they grow)\n",
+		c->arena->mapped >> 10, c->nconns, bufs >> 10);
+}
+
+// Runs until a stop signal (see sc_client_stop_on_signals); returns 0
+// then, -1 if the event backend failed
+int sc_client_run(struct sc_client *c, sc_tick_fn on_tick, void *arg) {
+	if (c->owns_arena) seal_arena(c);
+	if (c->nshards && sc_shards_start(c) < 0) return -1;
+	if (c->spin.cpu >= 0) sc_pin_thread(c->spin.cpu);
+	long long start_ns = sc_mono_ns(), cpu0 = thread_cpu_ns();
+	c->spin.last_event_ns = start_ns;
+	int rc = run_loop(c, on_tick, arg);
+	if (c->spin.idle_ns || c->lateness) report_loop(c, sc_mono_ns() - start_ns, thread_cpu_ns() - cpu0);
+	if (c->metrics) sc_metrics_snapshot(c, sc_mono_ns());
+	if (c->nshards) sc_shards_stop(c);
+	if (sc_client_flush(c) < 0) rc = -1;
+	return rc;
+}
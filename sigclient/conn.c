@@ -0,0 +1,588 @@
+// conn.c
+// Per-stream TCP connection: connect/reconnect, receive and tokenize
+// newline-delimited values in place in the connection's input buffer.
+//
+// Input buffers adapt to the load. A stream holds an SC_BUF_MAX slot of
+// the client's buffer pool while it is up and uses only the first cap
+// bytes, so pages it never grew into are never committed. Two reads in a row that fill the
+// free tail mean more was queued than one read could take: the buffer
+// doubles, and once it is at SC_BUF_MAX the socket's SO_RCVBUF does
+// instead. A buffer whose largest read stayed under a quarter of it for
+// SC_BUF_SHRINK_MS halves, and the pages it gave up go back to the kernel.
+//
+// Hosts are resolved once at start-up. A stream given by host name looks
+// it up again in the background (getaddrinfo_a) whenever its connection
+// drops, and the reconnect after that uses the new address once the
+// lookup is done; until then it retries the old one.
+//
+// With -A, every read is stamped with its arrival time (the kernel's
+// receive stamp, or the loop's clock read for the wakeup) and a value
+// stamped after the open window ended is held for the next window, even
+// though the loop handles it before that window's tick.
+
+#define _GNU_SOURCE     // madvise, getaddrinfo_a
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "sigclient.h"
+#include "scan.h"
+
+// Socket options go on before connect so that the handshake carries the
+// TOS and keepalive covers the whole connection. A failed option is not
+// worth losing the stream over, so errors are ignored.
+static void set_sockopts(int fd, int family, const struct sc_sockopts *o) {
+	int one = 1;
+	if (o->flags & SC_SOCK_NODELAY) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if (o->flags & SC_SOCK_QUICKACK) setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+	if (o->flags & SC_SOCK_KEEPALIVE) {
+		setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+		if (o->keep_idle_s) setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &o->keep_idle_s, sizeof(int));
+		if (o->keep_intvl_s) setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &o->keep_intvl_s, sizeof(int));
+		if (o->keep_count) setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &o->keep_count, sizeof(int));
+	}
+	if (o->flags & SC_SOCK_TOS) {
+		if (family == AF_INET6) setsockopt(fd, IPPROTO_IPV6, IPV6_TCLASS, &o->tos, sizeof(int));
+		else setsockopt(fd, IPPROTO_IP, IP_TOS, &o->tos, sizeof(int));
+	}
+}
+
+// Create a non-blocking socket and start connecting. Returns the fd, with
+// *in_progress set if the connect completes later (EINPROGRESS), or -1.
+int sc_connect_start(const struct sockaddr *addr, socklen_t addrlen, const struct sc_sockopts *opts,
+		int *in_progress) {
+	int fd = socket(addr->sa_family, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (sc_set_nonblocking(fd) < 0) {
+		close(fd);
+		return -1;
+	}
+	if (opts) set_sockopts(fd, addr->sa_family, opts);
+	*in_progress = 0;
+	if (connect(fd, addr, addrlen) < 0) {
+		if (errno != EINPROGRESS) {
+			close(fd);
+			return -1;
+		}
+		*in_progress = 1;
+	}
+	return fd;
+}
+
+// Background lookup of a stream's host name. malloc'd rather than from
+// the arena: the resolver thread may still write to it after the client
+// is gone if the lookup cannot be cancelled.
+struct sc_resolve {
+	struct gaicb cb;
+	struct addrinfo hints;
+	char host[SC_HOST_MAX];
+	char port[8];
+	int pending;
+};
+
+static void take_addr(struct sc_stream *s, const struct addrinfo *ai) {
+	memcpy(&s->addr, ai->ai_addr, ai->ai_addrlen);
+	s->addrlen = ai->ai_addrlen;
+}
+
+// Resolve host (a name or a literal IPv4/IPv6 address) once, blocking.
+// Returns 0 or a getaddrinfo error code (EAI_*).
+int sc_stream_resolve(struct sc_stream *s, const char *host, int port) {
+	struct addrinfo hints, *res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICSERV | AI_NUMERICHOST;
+	char portstr[8];
+	snprintf(portstr, sizeof(portstr), "%d", port);
+	s->resolve = NULL;
+	if (getaddrinfo(host, portstr, &hints, &res) == 0) {
+		take_addr(s, res);
+		freeaddrinfo(res);
+		return 0;
+	}
+	hints.ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG;
+	int rc = getaddrinfo(host, portstr, &hints, &res);
+	if (rc != 0) return rc;
+	take_addr(s, res);
+	freeaddrinfo(res);
+
+	struct sc_resolve *r = calloc(1, sizeof(*r));
+	if (!r) return EAI_MEMORY;
+	snprintf(r->host, sizeof(r->host), "%s", host);
+	memcpy(r->port, portstr, sizeof(r->port));
+	r->hints = hints;
+	s->resolve = r;
+	return 0;
+}
+
+// Start looking the host up again (named hosts, one lookup at a time)
+void sc_stream_refresh(struct sc_stream *s) {
+	struct sc_resolve *r = s->resolve;
+	if (!r || r->pending) return;
+	memset(&r->cb, 0, sizeof(r->cb));
+	r->cb.ar_name = r->host;
+	r->cb.ar_service = r->port;
+	r->cb.ar_request = &r->hints;
+	struct gaicb *list[1] = { &r->cb };
+	r->pending = getaddrinfo_a(GAI_NOWAIT, list, 1, NULL) == 0;
+}
+
+// Take the result of a finished lookup. A failed one keeps the old address.
+void sc_stream_poll_resolve(struct sc_stream *s) {
+	struct sc_resolve *r = s->resolve;
+	if (!r || !r->pending) return;
+	int rc = gai_error(&r->cb);
+	if (rc == EAI_INPROGRESS) return;
+	r->pending = 0;
+	if (rc != 0) return;
+	if (r->cb.ar_result) take_addr(s, r->cb.ar_result);
+	freeaddrinfo(r->cb.ar_result);
+}
+
+void sc_stream_resolve_free(struct sc_stream *s) {
+	struct sc_resolve *r = s->resolve;
+	if (!r) return;
+	s->resolve = NULL;
+	if (r->pending) {
+		// still running: the resolver thread owns it, leave it behind
+		if (gai_cancel(&r->cb) == EAI_NOTCANCELED) return;
+		if (gai_error(&r->cb) == 0) freeaddrinfo(r->cb.ar_result);
+	}
+	free(r);
+}
+
+// Re-enter quick-ack mode: the kernel leaves it on its own after a while
+void sc_conn_quickack(struct sc_conn *c) {
+	int one = 1;
+	setsockopt(c->fd, IPPROTO_TCP, TCP_QUICKACK, &one, sizeof(one));
+}
+
+void sc_conn_init(struct sc_conn *c, struct sc_stream *s, char *inbuf) {
+	c->fd = -1;
+	c->inlen = 0;
+	c->start = 0;
+	c->have = 0;
+	c->state = SC_CONN_IDLE;
+	c->inbuf = inbuf;
+	c->cap = SC_BUF_SIZE;
+	c->full = 0;
+	c->peak = 0;
+	c->discarding = 0;
+	c->light_since = 0;
+	c->value = SC_ABSENT;
+	c->stats = NULL;
+	c->arrival = NULL;
+	s->next_try = 0;
+	s->connect_started = 0;
+	s->backoff_ms = 0;
+}
+
+// Issue a connect for an idle stream. Returns 1 if it is already up, 0 if
+// in progress (wait for writable, then sc_conn_finish), -1 on failure.
+int sc_conn_start(struct sc_conn *c, struct sc_stream *s, long long now) {
+	int in_progress;
+	int fd = sc_connect_start((const struct sockaddr *)&s->addr, s->addrlen, &s->sock, &in_progress);
+	if (fd < 0) return -1;
+	c->fd = fd;
+	c->inlen = 0;
+	c->start = 0;
+	c->have = 0;
+	c->discarding = 0;
+	if (c->arrival) c->arrival->next_have = 0;
+	if (c->arrival && c->arrival->clock->mode == SC_ARRIVAL_KERNEL) {
+		int one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+	}
+	s->connect_started = now;
+	c->state = in_progress ? SC_CONN_CONNECTING : SC_CONN_UP;
+	if (!in_progress) s->backoff_ms = 0;
+	return in_progress ? 0 : 1;
+}
+
+// Complete a connect once the socket reported writable or an error.
+// Returns 0 when up, -1 if the connect failed.
+int sc_conn_finish(struct sc_conn *c, struct sc_stream *s) {
+	int err = 0;
+	socklen_t len = sizeof(err);
+	if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) return -1;
+	c->state = SC_CONN_UP;
+	s->backoff_ms = 0;
+	return 0;
+}
+
+// Close (if needed) and schedule the next attempt with backoff and jitter
+void sc_conn_retry_later(struct sc_conn *c, struct sc_stream *s, long long now, unsigned long long *rng) {
+	sc_conn_close(c);
+	int step = s->backoff_ms ? s->backoff_ms * 2 : SC_RECONNECT_MIN_MS;
+	if (step > SC_RECONNECT_MAX_MS) step = SC_RECONNECT_MAX_MS;
+	s->backoff_ms = step;
+	int half = step / 2;
+	s->next_try = now + half + (long long)(sc_rand_next(rng) % (unsigned long long)(half + 1));
+}
+
+void sc_conn_close(struct sc_conn *c) {
+	if (c->fd >= 0) close(c->fd);
+	c->fd = -1;
+	c->inlen = 0;
+	c->start = 0;
+	c->state = SC_CONN_IDLE;
+}
+
+static inline int is_space(char ch) {
+	return ch == '\n' || ch == '\r' || ch == ' ' || ch == '\t';
+}
+
+// Only the last value of a window is reported, so instead of splitting
+// every line we look backwards from the end of the new data: find the
+// last delimiter, then the last non-blank line before it, trim it by
+// moving its bounds and NUL-terminate it in place over the byte that
+// follows (whitespace or the delimiter). Nothing is copied; the value is
+// referenced by offset/length until the window ends. Numeric streams also
+// convert it once here, so consumers never re-parse the text.
+static void scan_last_line(struct sc_conn *c, int from, int to) {
+	char *buf = c->inbuf;
+	long d = sc_scan_last_delim(buf + from, to - from);
+	if (d < 0) return;  // no line completed in this chunk
+	int p = from + (int)d;
+
+	int e = p;
+	while (e > c->start && is_space(buf[e - 1])) e--;
+	if (e > c->start) {
+		d = sc_scan_last_delim(buf + c->start, e - c->start);
+		int b = d < 0 ? c->start : c->start + (int)d + 1;
+		while (b < e && (buf[b] == ' ' || buf[b] == '\t')) b++;
+		if (e - b > SC_TOKEN_MAX - 1) {
+			e = b + SC_TOKEN_MAX - 1;
+			if (c->metrics) c->metrics->truncated++;
+		}
+		buf[e] = '\0';
+		c->fresh = 1;
+		double v = SC_ABSENT;
+		if (c->numeric) sc_parse_double(buf + b, e - b, &v);
+		struct sc_arrival_conn *a = c->arrival;
+		if (a && c->numeric) {
+			a->prev_value = a->next_have ? a->next_value : c->value;
+			a->prev_ns = a->next_have ? a->next_ns : c->value_ns;
+		}
+		if (a && a->rx_ns >= a->clock->close_ns) {
+			if (!a->next_have) {
+				a->after_value = v;
+				a->after_ns = a->rx_ns;
+			}
+			a->next_off = b;
+			a->next_len = e - b;
+			a->next_have = 1;
+			a->next_value = v;
+			a->next_ns = a->rx_ns;
+		} else {
+			c->lat_off = b;
+			c->lat_len = e - b;
+			c->have = 1;
+			c->value = v;
+			if (a) c->value_ns = a->rx_ns;    // else stamped by the loop (conn_arrived)
+		}
+	}
+	c->start = p + 1;
+}
+
+// Aggregated streams need every sample, not just the last: walk all
+// lines completed by buf[from..to) and add each numeric one to the
+// window's stats (or the next one's, see scan_last_line). Runs before
+// scan_last_line, which moves c->start.
+static void scan_all_lines(struct sc_conn *c, int from, int to) {
+	char *buf = c->inbuf;
+	const struct sc_arrival_conn *a = c->arrival;
+	struct sc_stats *st = a && a->rx_ns >= a->clock->close_ns ? a->next_stats : c->stats;
+	uint32_t pos[64];
+	int b = c->start;
+	while (from < to) {
+		size_t n = sc_scan_delims(buf + from, to - from, pos, 64);
+		if (n == 0) break;
+		for (size_t k = 0; k < n; ++k) {
+			int e = from + (int)pos[k];
+			int l = b;
+			while (l < e && is_space(buf[l])) l++;
+			double x;
+			if (l < e && sc_parse_double(buf + l, e - l, &x) > 0) sc_stats_add(st, x);
+			b = e + 1;
+		}
+		from += (int)pos[n - 1] + 1;
+	}
+}
+
+static int grow(struct sc_conn *c) {
+	if (c->cap >= SC_BUF_MAX) return 0;
+	c->cap *= 2;
+	c->light_since = 0;
+	if (c->metrics) c->metrics->inbuf = (uint64_t)c->cap;
+	return 1;
+}
+
+// Double the socket's receive buffer, up to SC_RCVBUF_MAX (and the
+// system's rmem_max). getsockopt reports twice the set value, so setting
+// what it reports doubles it. Setting it ends the kernel's autotuning for
+// the socket, which is why this waits until a full-size inbuf fell behind.
+static void raise_rcvbuf(int fd) {
+	int cur;
+	socklen_t len = sizeof(cur);
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &cur, &len) < 0 || cur >= SC_RCVBUF_MAX) return;
+	if (cur > SC_RCVBUF_MAX / 2) cur = SC_RCVBUF_MAX / 2;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &cur, sizeof(cur));
+}
+
+// Give the pages of buf[from, to) back to the kernel (whole pages only)
+static void release_pages(char *buf, size_t from, size_t to) {
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	from = (from + page - 1) & ~(page - 1);
+	if (from < to) madvise(buf + from, to - from, MADV_DONTNEED);
+}
+
+// -A: a value is held for the next window
+static inline int next_have(const struct sc_conn *c) {
+	return c->arrival && c->arrival->next_have;
+}
+
+// Drop what is before the partial line (and before the window's values,
+// while they are still needed) with one memmove
+static void compact(struct sc_conn *c) {
+	int keep = c->start;
+	if (c->have && c->lat_off < keep) keep = c->lat_off;
+	if (next_have(c) && c->arrival->next_off < keep) keep = c->arrival->next_off;
+	if (keep > 0) {
+		memmove(c->inbuf, c->inbuf + keep, c->inlen - keep);
+		c->inlen -= keep;
+		c->start -= keep;
+		c->lat_off -= keep;
+		if (c->arrival) c->arrival->next_off -= keep;
+	}
+}
+
+// Make room at the tail of inbuf before the next read. Compacting only
+// happens when the tail runs low rather than after every read. Returns
+// the free tail size.
+int sc_conn_reserve(struct sc_conn *c) {
+	if (c->start == c->inlen && !c->have && !next_have(c)) c->start = c->inlen = 0;
+	if (c->cap - c->inlen >= c->cap / 4) return c->cap - c->inlen;
+
+	compact(c);
+	// a long partial line: grow so it can complete, and once even
+	// SC_BUF_MAX is full drop it but keep the windows' values, which
+	// always end before the partial line. The rest of the line is
+	// skipped as it arrives (see sc_conn_feed), not taken as a sample.
+	if (c->cap - c->inlen < c->cap / 4) grow(c);
+	if (c->inlen == c->cap) {
+		const struct sc_arrival_conn *a = c->arrival;
+		c->inlen = c->start = next_have(c) ? a->next_off + a->next_len + 1 : c->have ? c->lat_off + c->lat_len + 1 : 0;
+		c->discarding = 1;
+		if (c->metrics) c->metrics->truncated++;
+	}
+	return c->cap - c->inlen;
+}
+
+// Count a read of n bytes; full if it filled the free tail, which grows
+// the buffer when it happens twice in a row
+void sc_conn_count_read(struct sc_conn *c, size_t n, int full) {
+	if ((int)n > c->peak) c->peak = (int)n;
+	if (c->metrics) c->metrics->reads++;
+	if (!full) {
+		c->full = 0;
+		return;
+	}
+	if (++c->full < 2) return;
+	c->full = 0;
+	if (!grow(c)) raise_rcvbuf(c->fd);
+}
+
+// Once per window: halve a grown buffer that reads have not needed for
+// SC_BUF_SHRINK_MS. Not while a completion read owns the free tail.
+void sc_conn_adapt(struct sc_conn *c, long long now) {
+	int peak = c->peak;
+	c->peak = 0;
+	if (c->cap == SC_BUF_SIZE || peak >= c->cap / 4) {
+		c->light_since = 0;
+		return;
+	}
+	if (!c->light_since) c->light_since = now;
+	if (now - c->light_since < SC_BUF_SHRINK_MS) return;
+
+	int cap = c->cap / 2;
+	compact(c);
+	if (c->inlen > cap / 2) return;     // still holds a long line
+	release_pages(c->inbuf, (size_t)cap, (size_t)c->cap);
+	c->cap = cap;
+	c->light_since = now;
+	if (c->metrics) c->metrics->inbuf = (uint64_t)c->cap;
+}
+
+// Lines completed in buf[0..len), for the metrics
+static uint64_t count_lines(const char *buf, size_t len) {
+	uint32_t pos[64];
+	uint64_t lines = 0;
+	size_t n;
+	while (len && (n = sc_scan_delims(buf, len, pos, 64)) > 0) {
+		for (size_t k = 0; k < n; ++k) lines += buf[pos[k]] == '\n';
+		size_t used = pos[n - 1] + 1;
+		buf += used;
+		len -= used;
+	}
+	return lines;
+}
+
+// Account for n bytes that were received at inbuf + inlen
+void sc_conn_feed(struct sc_conn *c, size_t n) {
+	int from = c->inlen;
+	c->inlen += (int)n;
+	if (c->metrics) {
+		c->metrics->bytes += n;
+		c->metrics->samples += count_lines(c->inbuf + from, n);
+	}
+	if (c->discarding) {
+		// the tail of a dropped line: keep only what follows its end
+		uint32_t end;
+		if (sc_scan_delims(c->inbuf + from, n, &end, 1) == 0) {
+			c->inlen = from;
+			return;
+		}
+		from += (int)end + 1;
+		c->start = from;
+		c->discarding = 0;
+	}
+	if (c->stats) scan_all_lines(c, from, c->inlen);
+	scan_last_line(c, from, c->inlen);
+}
+
+// Take the input buffer from a closed connection whose window is over,
+// back at SC_BUF_SIZE with the rest of its pages released. The caller
+// returns it to the pool.
+char *sc_conn_release(struct sc_conn *c) {
+	char *buf = c->inbuf;
+	release_pages(buf, SC_BUF_SIZE, (size_t)c->cap);
+	c->inbuf = NULL;
+	c->inlen = c->start = 0;
+	c->cap = SC_BUF_SIZE;
+	c->full = c->peak = 0;
+	c->light_since = 0;
+	if (c->metrics) c->metrics->inbuf = 0;
+	return buf;
+}
+
+// Append n bytes received into a buffer of the backend (multishot recv)
+void sc_conn_copy_in(struct sc_conn *c, const char *data, size_t n) {
+	int room = sc_conn_reserve(c);
+	sc_conn_count_read(c, n, n > (size_t)room);
+	while (n) {
+		size_t take = n < (size_t)room ? n : (size_t)room;
+		memcpy(c->inbuf + c->inlen, data, take);
+		sc_conn_feed(c, take);
+		data += take;
+		n -= take;
+		if (n) room = sc_conn_reserve(c);
+	}
+}
+
+// recv that takes the kernel's receive stamp of the data as rx_ns. The
+// stamp is wall-clock time; one later than the loop's own clock read
+// (a stepped clock) is not used.
+static ssize_t recv_stamped(struct sc_conn *c, int room) {
+	struct iovec iov = { c->inbuf + c->inlen, (size_t)room };
+	union {
+		char buf[CMSG_SPACE(sizeof(struct timespec))];
+		struct cmsghdr align;
+	} ctl;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = ctl.buf;
+	msg.msg_controllen = sizeof(ctl.buf);
+	ssize_t r = recvmsg(c->fd, &msg, 0);
+	if (r <= 0) return r;
+	for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+		if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMPNS) continue;
+		struct timespec ts;
+		memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+		long long ns = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec - c->arrival->clock->rt_off_ns;
+		if (ns < c->arrival->rx_ns) c->arrival->rx_ns = ns;
+	}
+	return r;
+}
+
+// Read until EAGAIN. Returns 0 while connected, -1 if the remote closed or
+// the socket failed; the caller is responsible for closing it.
+int sc_conn_read(struct sc_conn *c) {
+	int stamped = c->arrival && c->arrival->clock->mode == SC_ARRIVAL_KERNEL;
+	long long loop_ns = stamped ? c->arrival->rx_ns : 0;
+	while (1) {
+		int room = sc_conn_reserve(c);
+		if (stamped) c->arrival->rx_ns = loop_ns;
+		ssize_t r = stamped ? recv_stamped(c, room) : recv(c->fd, c->inbuf + c->inlen, room, 0);
+		if (r > 0) {
+			sc_conn_feed(c, r);
+			sc_conn_count_read(c, (size_t)r, r == room);
+			continue;
+		}
+		if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		return -1;
+	}
+}
+
+// -A ...,interp: replace the window's numeric value by its estimate at
+// the window end, interpolated towards the first sample of the next
+// window if one has arrived, else extrapolated from the sample before
+// (no further ahead than the two are apart)
+void sc_conn_align(struct sc_conn *c, long long end_ns) {
+	const struct sc_arrival_conn *a = c->arrival;
+	if (!a || !c->have || c->value != c->value) return;
+	double v0 = a->prev_value, v1 = c->value;
+	long long t0 = a->prev_ns, t1 = c->value_ns;
+	if (a->next_have) {
+		v0 = v1;
+		t0 = t1;
+		v1 = a->after_value;
+		t1 = a->after_ns;
+	} else if (!t0 || end_ns - t1 > t1 - t0) {
+		return;
+	}
+	if (t1 <= t0 || v0 != v0 || v1 != v1) return;
+	c->value = v0 + (v1 - v0) * (double)(end_ns - t0) / (double)(t1 - t0);
+}
+
+// End of a window: values and statistics held for the next window
+// become its own
+void sc_conn_next_window(struct sc_conn *c) {
+	struct sc_arrival_conn *a = c->arrival;
+	c->have = a->next_have;
+	if (a->next_have) {
+		c->lat_off = a->next_off;
+		c->lat_len = a->next_len;
+		c->value = a->next_value;
+		c->value_ns = a->next_ns;
+		a->next_have = 0;
+	}
+	if (c->stats) {
+		struct sc_stats *st = c->stats;
+		sc_stats_reset(st);
+		c->stats = a->next_stats;
+		a->next_stats = st;
+	}
+}
+
+// Value of the current window (NUL-terminated inside inbuf), NULL if none
+const char *sc_conn_value(const struct sc_conn *c) {
+	return c->have ? c->inbuf + c->lat_off : NULL;
+}
+
+// Parsed value of the current window (numeric streams only); SC_ABSENT
+// if there is none or it was not a number
+double sc_conn_number(const struct sc_conn *c) {
+	return c->have ? c->value : SC_ABSENT;
+}
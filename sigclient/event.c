@@ -0,0 +1,102 @@
+// event.c
+// Backend selection and dispatch for event.h.
+
+#include <string.h>
+#include <errno.h>
+
+#include "event_impl.h"
+
+// Build-time default, overridable at run time (see sc_options_init)
+#ifndef SC_EV_DEFAULT_NAME
+#define SC_EV_DEFAULT_NAME "poll"
+#endif
+
+static const char *const backend_names[] = {
+	[SC_EV_POLL] = "poll",
+	[SC_EV_EPOLL] = "epoll",
+	[SC_EV_URING] = "uring",
+};
+
+struct sc_evloop *sc_ev_create(enum sc_ev_backend backend, int max_fds) {
+	switch (backend) {
+	case SC_EV_POLL: return sc_ev_poll_create(max_fds);
+	case SC_EV_EPOLL: return sc_ev_epoll_create(max_fds);
+	case SC_EV_URING: return sc_ev_uring_create(max_fds);
+	}
+	errno = EINVAL;
+	return NULL;
+}
+
+void sc_ev_destroy(struct sc_evloop *ev) {
+	if (ev) ev->ops->destroy(ev);
+}
+
+enum sc_ev_backend sc_ev_backend_of(const struct sc_evloop *ev) {
+	return ev->backend;
+}
+
+int sc_ev_add(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	return ev->ops->add(ev, fd, events, data);
+}
+
+int sc_ev_mod(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	return ev->ops->mod(ev, fd, events, data);
+}
+
+int sc_ev_del(struct sc_evloop *ev, int fd) {
+	return ev->ops->del(ev, fd);
+}
+
+int sc_ev_wait(struct sc_evloop *ev, struct sc_event *out, int max, int timeout_ms) {
+	return ev->ops->wait(ev, out, max, timeout_ms);
+}
+
+int sc_ev_can_read(const struct sc_evloop *ev) {
+	return ev->ops->read != NULL;
+}
+
+int sc_ev_register_buffers(struct sc_evloop *ev, const struct iovec *iov, int n) {
+	if (!ev->ops->register_buffers) { errno = ENOTSUP; return -1; }
+	return ev->ops->register_buffers(ev, iov, n);
+}
+
+int sc_ev_read(struct sc_evloop *ev, int fd, void *buf, size_t len, int buf_index) {
+	if (!ev->ops->read) { errno = ENOTSUP; return -1; }
+	return ev->ops->read(ev, fd, buf, len, buf_index);
+}
+
+int sc_ev_provide_buffers(struct sc_evloop *ev, unsigned n, size_t size) {
+	if (!ev->ops->provide_buffers) { errno = ENOTSUP; return -1; }
+	return ev->ops->provide_buffers(ev, n, size);
+}
+
+int sc_ev_recv(struct sc_evloop *ev, int fd) {
+	if (!ev->ops->recv) { errno = ENOTSUP; return -1; }
+	return ev->ops->recv(ev, fd);
+}
+
+void sc_ev_recv_done(struct sc_evloop *ev, const struct sc_event *e) {
+	if (ev->ops->recv_done) ev->ops->recv_done(ev, e);
+}
+
+const char *sc_ev_backend_name(enum sc_ev_backend backend) {
+	if ((unsigned)backend >= sizeof(backend_names) / sizeof(backend_names[0])) return "?";
+	return backend_names[backend];
+}
+
+int sc_ev_backend_parse(const char *name, enum sc_ev_backend *out) {
+	for (unsigned i = 0; i < sizeof(backend_names) / sizeof(backend_names[0]); ++i) {
+		if (strcmp(name, backend_names[i]) == 0) {
+			*out = (enum sc_ev_backend)i;
+			return 0;
+		}
+	}
+	if (strcmp(name, "io_uring") == 0) { *out = SC_EV_URING; return 0; }
+	return -1;
+}
+
+enum sc_ev_backend sc_ev_default_backend(void) {
+	enum sc_ev_backend b = SC_EV_POLL;
+	sc_ev_backend_parse(SC_EV_DEFAULT_NAME, &b);
+	return b;
+}
@@ -0,0 +1,74 @@
+// event.h
+// Pluggable event backend for the ingest loop. Interest sets are
+// persistent: fds are added on connect and removed on disconnect, and
+// each wait only reports what became ready.
+//
+// poll and epoll are readiness backends; the caller does its own recv().
+// io_uring can also perform the reads itself (sc_ev_read) into buffers
+// registered up front, reporting SC_EV_READ completions, or keep one
+// multishot receive per fd armed (sc_ev_recv) that delivers data in
+// buffers the backend owns, reporting SC_EV_RECV.
+
+#ifndef SIGCLIENT_EVENT_H
+#define SIGCLIENT_EVENT_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+enum sc_ev_backend {
+	SC_EV_POLL,
+	SC_EV_EPOLL,
+	SC_EV_URING,
+};
+
+#define SC_EV_IN   0x1u   // readable
+#define SC_EV_OUT  0x2u   // writable
+#define SC_EV_ERR  0x4u   // error or hangup
+#define SC_EV_READ 0x8u   // sc_ev_read() completed, res holds bytes or -errno
+#define SC_EV_RECV 0x10u  // sc_ev_recv() data: res bytes at buf
+
+struct sc_event {
+	void *data;
+	unsigned events;
+	int res;
+	void *buf;          // SC_EV_RECV only
+	unsigned buf_id;
+};
+
+struct sc_evloop;
+
+// Returns NULL (errno set) if the backend is not compiled in or not
+// supported by the running kernel. All per-fd state is allocated here,
+// for max_fds registered at once; sc_ev_add fails with ENOSPC beyond it.
+struct sc_evloop *sc_ev_create(enum sc_ev_backend backend, int max_fds);
+void sc_ev_destroy(struct sc_evloop *ev);
+enum sc_ev_backend sc_ev_backend_of(const struct sc_evloop *ev);
+
+int sc_ev_add(struct sc_evloop *ev, int fd, unsigned events, void *data);
+int sc_ev_mod(struct sc_evloop *ev, int fd, unsigned events, void *data);
+int sc_ev_del(struct sc_evloop *ev, int fd);
+
+// Wait up to timeout_ms (-1 forever). Returns the number of events
+// stored in out (0 on timeout or EINTR), -1 on error.
+int sc_ev_wait(struct sc_evloop *ev, struct sc_event *out, int max, int timeout_ms);
+
+// Completion reads, only on backends where sc_ev_can_read() is true.
+// buf_index selects a buffer from sc_ev_register_buffers(), -1 for none.
+int sc_ev_can_read(const struct sc_evloop *ev);
+int sc_ev_register_buffers(struct sc_evloop *ev, const struct iovec *iov, int n);
+int sc_ev_read(struct sc_evloop *ev, int fd, void *buf, size_t len, int buf_index);
+
+// Multishot receive: after sc_ev_provide_buffers() succeeded (n buffers
+// of size bytes, n a power of two), sc_ev_recv() arms one receive that
+// keeps reporting SC_EV_RECV until the fd is removed, or SC_EV_READ
+// once with res 0 (closed) or -errno. Every SC_EV_RECV buffer must be
+// handed back with sc_ev_recv_done(), also when the data is discarded.
+int sc_ev_provide_buffers(struct sc_evloop *ev, unsigned n, size_t size);
+int sc_ev_recv(struct sc_evloop *ev, int fd);
+void sc_ev_recv_done(struct sc_evloop *ev, const struct sc_event *e);
+
+const char *sc_ev_backend_name(enum sc_ev_backend backend);
+int sc_ev_backend_parse(const char *name, enum sc_ev_backend *out);
+enum sc_ev_backend sc_ev_default_backend(void);
+
+#endif
@@ -0,0 +1,98 @@
+// event_epoll.c
+// Linux epoll backend, edge-triggered. Callers must drain a readable fd
+// until EAGAIN (sc_conn_read already does).
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "event_impl.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define EPOLL_BATCH 64
+
+struct epoll_loop {
+	struct sc_evloop base;
+	int epfd;
+};
+
+static int ctl(struct epoll_loop *p, int op, int fd, unsigned events, void *data) {
+	struct epoll_event e;
+	e.events = EPOLLET | EPOLLRDHUP;
+	if (events & SC_EV_IN) e.events |= EPOLLIN;
+	if (events & SC_EV_OUT) e.events |= EPOLLOUT;
+	e.data.ptr = data;
+	return epoll_ctl(p->epfd, op, fd, &e);
+}
+
+static int epoll_add(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	return ctl((struct epoll_loop *)ev, EPOLL_CTL_ADD, fd, events, data);
+}
+
+static int epoll_mod(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	return ctl((struct epoll_loop *)ev, EPOLL_CTL_MOD, fd, events, data);
+}
+
+static int epoll_del(struct sc_evloop *ev, int fd) {
+	struct epoll_loop *p = (struct epoll_loop *)ev;
+	return epoll_ctl(p->epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static int epoll_wait_events(struct sc_evloop *ev, struct sc_event *out, int max, int timeout_ms) {
+	struct epoll_loop *p = (struct epoll_loop *)ev;
+	struct epoll_event evs[EPOLL_BATCH];
+	if (max > EPOLL_BATCH) max = EPOLL_BATCH;
+	int res = epoll_wait(p->epfd, evs, max, timeout_ms);
+	if (res < 0) return errno == EINTR ? 0 : -1;
+	for (int i = 0; i < res; ++i) {
+		unsigned e = 0;
+		// RDHUP is reported as readable: the next recv() returns 0
+		if (evs[i].events & (EPOLLIN | EPOLLRDHUP)) e |= SC_EV_IN;
+		if (evs[i].events & EPOLLOUT) e |= SC_EV_OUT;
+		if (evs[i].events & (EPOLLERR | EPOLLHUP)) e |= SC_EV_ERR;
+		out[i].data = evs[i].data.ptr;
+		out[i].events = e;
+		out[i].res = 0;
+	}
+	return res;
+}
+
+static void epoll_destroy(struct sc_evloop *ev) {
+	struct epoll_loop *p = (struct epoll_loop *)ev;
+	close(p->epfd);
+	free(p);
+}
+
+static const struct sc_ev_ops epoll_ops = {
+	.add = epoll_add,
+	.mod = epoll_mod,
+	.del = epoll_del,
+	.wait = epoll_wait_events,
+	.destroy = epoll_destroy,
+};
+
+struct sc_evloop *sc_ev_epoll_create(int max_fds) {
+	(void)max_fds;  // the interest set lives in the kernel
+	struct epoll_loop *p = calloc(1, sizeof(*p));
+	if (!p) return NULL;
+	p->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (p->epfd < 0) {
+		free(p);
+		return NULL;
+	}
+	p->base.ops = &epoll_ops;
+	p->base.backend = SC_EV_EPOLL;
+	return &p->base;
+}
+
+#else
+
+struct sc_evloop *sc_ev_epoll_create(int max_fds) {
+	(void)max_fds;
+	errno = ENOTSUP;
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,32 @@
+// event_impl.h
+// Backend interface behind event.h. Each backend embeds struct sc_evloop
+// as its first member and provides an ops table.
+
+#ifndef SIGCLIENT_EVENT_IMPL_H
+#define SIGCLIENT_EVENT_IMPL_H
+
+#include "event.h"
+
+struct sc_ev_ops {
+	int (*add)(struct sc_evloop *ev, int fd, unsigned events, void *data);
+	int (*mod)(struct sc_evloop *ev, int fd, unsigned events, void *data);
+	int (*del)(struct sc_evloop *ev, int fd);
+	int (*wait)(struct sc_evloop *ev, struct sc_event *out, int max, int timeout_ms);
+	int (*register_buffers)(struct sc_evloop *ev, const struct iovec *iov, int n);
+	int (*read)(struct sc_evloop *ev, int fd, void *buf, size_t len, int buf_index);
+	int (*provide_buffers)(struct sc_evloop *ev, unsigned n, size_t size);
+	int (*recv)(struct sc_evloop *ev, int fd);
+	void (*recv_done)(struct sc_evloop *ev, const struct sc_event *e);
+	void (*destroy)(struct sc_evloop *ev);
+};
+
+struct sc_evloop {
+	const struct sc_ev_ops *ops;
+	enum sc_ev_backend backend;
+};
+
+struct sc_evloop *sc_ev_poll_create(int max_fds);
+struct sc_evloop *sc_ev_epoll_create(int max_fds);
+struct sc_evloop *sc_ev_uring_create(int max_fds);
+
+#endif
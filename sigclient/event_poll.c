@@ -0,0 +1,116 @@
+// event_poll.c
+// Portable poll() backend. The pollfd array is kept across waits and only
+// edited on add/del, so a wakeup costs one poll() plus a scan of the
+// fds that are actually registered. Both tables are sized for max_fds at
+// create time; add never allocates.
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+
+#include "event_impl.h"
+
+struct poll_loop {
+	struct sc_evloop base;
+	struct pollfd *pfds;
+	void **data;
+	int nfds;
+	int cap;
+};
+
+static short to_poll(unsigned events) {
+	short e = 0;
+	if (events & SC_EV_IN) e |= POLLIN;
+	if (events & SC_EV_OUT) e |= POLLOUT;
+	return e;
+}
+
+static int find(struct poll_loop *p, int fd) {
+	for (int i = 0; i < p->nfds; ++i)
+		if (p->pfds[i].fd == fd) return i;
+	return -1;
+}
+
+static int poll_add(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	struct poll_loop *p = (struct poll_loop *)ev;
+	if (find(p, fd) >= 0) { errno = EEXIST; return -1; }
+	if (p->nfds == p->cap) { errno = ENOSPC; return -1; }
+	p->pfds[p->nfds].fd = fd;
+	p->pfds[p->nfds].events = to_poll(events);
+	p->pfds[p->nfds].revents = 0;
+	p->data[p->nfds] = data;
+	p->nfds++;
+	return 0;
+}
+
+static int poll_mod(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	struct poll_loop *p = (struct poll_loop *)ev;
+	int i = find(p, fd);
+	if (i < 0) { errno = ENOENT; return -1; }
+	p->pfds[i].events = to_poll(events);
+	p->data[i] = data;
+	return 0;
+}
+
+static int poll_del(struct sc_evloop *ev, int fd) {
+	struct poll_loop *p = (struct poll_loop *)ev;
+	int i = find(p, fd);
+	if (i < 0) { errno = ENOENT; return -1; }
+	// swap-remove; order of the interest set does not matter
+	p->nfds--;
+	p->pfds[i] = p->pfds[p->nfds];
+	p->data[i] = p->data[p->nfds];
+	return 0;
+}
+
+static int poll_wait(struct sc_evloop *ev, struct sc_event *out, int max, int timeout_ms) {
+	struct poll_loop *p = (struct poll_loop *)ev;
+	int res = poll(p->pfds, p->nfds, timeout_ms);
+	if (res < 0) return errno == EINTR ? 0 : -1;
+	int n = 0;
+	for (int i = 0; i < p->nfds && n < max && res > 0; ++i) {
+		short re = p->pfds[i].revents;
+		if (!re) continue;
+		res--;
+		unsigned e = 0;
+		if (re & POLLIN) e |= SC_EV_IN;
+		if (re & POLLOUT) e |= SC_EV_OUT;
+		if (re & (POLLHUP | POLLERR | POLLNVAL)) e |= SC_EV_ERR;
+		out[n].data = p->data[i];
+		out[n].events = e;
+		out[n].res = 0;
+		n++;
+	}
+	return n;
+}
+
+static void poll_destroy(struct sc_evloop *ev) {
+	struct poll_loop *p = (struct poll_loop *)ev;
+	free(p->pfds);
+	free(p->data);
+	free(p);
+}
+
+static const struct sc_ev_ops poll_ops = {
+	.add = poll_add,
+	.mod = poll_mod,
+	.del = poll_del,
+	.wait = poll_wait,
+	.destroy = poll_destroy,
+};
+
+struct sc_evloop *sc_ev_poll_create(int max_fds) {
+	struct poll_loop *p = calloc(1, sizeof(*p));
+	if (!p) return NULL;
+	p->cap = max_fds < 1 ? 1 : max_fds;
+	p->pfds = calloc((size_t)p->cap, sizeof(*p->pfds));
+	p->data = calloc((size_t)p->cap, sizeof(*p->data));
+	if (!p->pfds || !p->data) {
+		poll_destroy(&p->base);
+		return NULL;
+	}
+	p->base.ops = &poll_ops;
+	p->base.backend = SC_EV_POLL;
+	return &p->base;
+}
@@ -0,0 +1,454 @@
+// event_uring.c
+// io_uring backend using the raw syscalls (no liburing dependency).
+//
+// Readiness interest is emulated with one-shot POLL_ADD that is re-armed
+// after each completion, so it behaves like level-triggered poll. Data
+// fds can instead hand their reads to the ring with sc_ev_read(): with
+// buffers registered via sc_ev_register_buffers() these become
+// READ_FIXED straight into the connection's input buffer. Or one
+// multishot RECV per fd (sc_ev_recv) picks buffers from a provided
+// buffer ring and keeps completing without being resubmitted; buffers
+// go back on the ring in sc_ev_recv_done.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+
+#include "event_impl.h"
+
+#if defined(__linux__) && defined(SC_HAVE_URING)
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// user_data layout: gen(32) | poll seq(8) | kind(8) | slot(16)
+#define UD_TIMEOUT ((uint64_t)-1)
+#define UD_CANCEL ((uint64_t)-2)
+#define KIND_POLL 1
+#define KIND_READ 2
+#define KIND_RECV 3
+#define MAX_SLOTS 0xffff
+#define BUF_GROUP 0
+
+struct uring_slot {
+	int fd;             // -1 when free
+	unsigned events;    // poll interest (0: none)
+	void *data;
+	uint32_t gen;       // bumped on del so late completions are dropped
+	uint8_t pseq;       // bumped on mod so a superseded poll is dropped
+	uint64_t poll_ud;   // 0 when not armed
+	uint64_t read_ud;   // read or multishot recv
+};
+
+struct uring_loop {
+	struct sc_evloop base;
+	int ring_fd;
+	void *sq_ptr, *cq_ptr;
+	size_t sq_len, cq_len;
+	struct io_uring_sqe *sqes;
+	size_t sqes_len;
+	unsigned *sq_head, *sq_tail, *sq_array;
+	unsigned sq_mask, sq_entries;
+	unsigned *cq_head, *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+	unsigned to_submit;
+	struct __kernel_timespec ts;
+	struct uring_slot *slots;
+	int nslots;
+	struct io_uring_buf_ring *br;   // provided buffers, NULL if none
+	size_t br_len;
+	char *bufs;
+	size_t buf_size;
+	unsigned nbufs;
+	uint16_t br_tail;
+};
+
+static uint64_t make_ud(const struct uring_slot *s, int slot, unsigned kind) {
+	return ((uint64_t)s->gen << 32) | ((uint64_t)s->pseq << 24) | ((uint64_t)kind << 16) | (uint64_t)slot;
+}
+
+static int enter(struct uring_loop *u, unsigned min_complete, unsigned flags) {
+	int ret = (int)syscall(__NR_io_uring_enter, u->ring_fd, u->to_submit, min_complete, flags, NULL, 0);
+	if (ret < 0) return -1;
+	u->to_submit -= (unsigned)ret < u->to_submit ? (unsigned)ret : u->to_submit;
+	return ret;
+}
+
+// Without SQPOLL the kernel only looks at the SQ inside io_uring_enter(),
+// so publishing the tail before the entry is filled in is safe.
+static struct io_uring_sqe *get_sqe(struct uring_loop *u) {
+	unsigned tail = *u->sq_tail;
+	unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+	if (tail - head >= u->sq_entries) {
+		if (enter(u, 0, 0) < 0) return NULL;
+		head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+		if (tail - head >= u->sq_entries) { errno = EBUSY; return NULL; }
+	}
+	unsigned idx = tail & u->sq_mask;
+	struct io_uring_sqe *sqe = &u->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	u->sq_array[idx] = idx;
+	__atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	u->to_submit++;
+	return sqe;
+}
+
+static int arm_poll(struct uring_loop *u, int slot) {
+	struct uring_slot *s = &u->slots[slot];
+	struct io_uring_sqe *sqe = get_sqe(u);
+	if (!sqe) return -1;
+	unsigned pe = 0;
+	if (s->events & SC_EV_IN) pe |= POLLIN | POLLRDHUP;
+	if (s->events & SC_EV_OUT) pe |= POLLOUT;
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = s->fd;
+	sqe->poll32_events = pe;
+	sqe->user_data = s->poll_ud = make_ud(s, slot, KIND_POLL);
+	return 0;
+}
+
+static void cancel(struct uring_loop *u, uint64_t ud) {
+	struct io_uring_sqe *sqe = get_sqe(u);
+	if (!sqe) return;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = ud;
+	sqe->user_data = UD_CANCEL;
+}
+
+static int find(struct uring_loop *u, int fd) {
+	for (int i = 0; i < u->nslots; ++i)
+		if (u->slots[i].fd == fd) return i;
+	return -1;
+}
+
+static int uring_add(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	if (find(u, fd) >= 0) { errno = EEXIST; return -1; }
+	int slot = find(u, -1);
+	if (slot < 0) { errno = ENOSPC; return -1; }   // all max_fds slots taken
+	struct uring_slot *s = &u->slots[slot];
+	s->fd = fd;
+	s->events = events & (SC_EV_IN | SC_EV_OUT);
+	s->data = data;
+	s->poll_ud = s->read_ud = 0;
+	if (s->events) return arm_poll(u, slot);
+	return 0;
+}
+
+static int uring_mod(struct sc_evloop *ev, int fd, unsigned events, void *data) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	int slot = find(u, fd);
+	if (slot < 0) { errno = ENOENT; return -1; }
+	struct uring_slot *s = &u->slots[slot];
+	if (s->poll_ud) cancel(u, s->poll_ud);
+	s->poll_ud = 0;
+	s->pseq++;
+	s->events = events & (SC_EV_IN | SC_EV_OUT);
+	s->data = data;
+	if (s->events) return arm_poll(u, slot);
+	return 0;
+}
+
+static int uring_del(struct sc_evloop *ev, int fd) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	int slot = find(u, fd);
+	if (slot < 0) { errno = ENOENT; return -1; }
+	struct uring_slot *s = &u->slots[slot];
+	if (s->poll_ud) cancel(u, s->poll_ud);
+	if (s->read_ud) cancel(u, s->read_ud);
+	s->fd = -1;
+	s->gen++;
+	s->poll_ud = s->read_ud = 0;
+	return 0;
+}
+
+static int uring_read(struct sc_evloop *ev, int fd, void *buf, size_t len, int buf_index) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	int slot = find(u, fd);
+	if (slot < 0) { errno = ENOENT; return -1; }
+	struct uring_slot *s = &u->slots[slot];
+	if (s->read_ud) { errno = EBUSY; return -1; }
+	struct io_uring_sqe *sqe = get_sqe(u);
+	if (!sqe) return -1;
+	sqe->opcode = buf_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = (uint32_t)len;
+	sqe->off = (uint64_t)-1;   // sockets have no file position
+	if (buf_index >= 0) sqe->buf_index = (uint16_t)buf_index;
+	sqe->user_data = s->read_ud = make_ud(s, slot, KIND_READ);
+	return 0;
+}
+
+// Multishot RECV on fd: the kernel picks a provided buffer per completion
+static int arm_recv(struct uring_loop *u, int slot) {
+	struct uring_slot *s = &u->slots[slot];
+	struct io_uring_sqe *sqe = get_sqe(u);
+	if (!sqe) return -1;
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = s->fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BUF_GROUP;
+	sqe->user_data = s->read_ud = make_ud(s, slot, KIND_RECV);
+	return 0;
+}
+
+static int uring_recv(struct sc_evloop *ev, int fd) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	int slot = find(u, fd);
+	if (slot < 0) { errno = ENOENT; return -1; }
+	if (!u->br) { errno = ENOTSUP; return -1; }
+	if (u->slots[slot].read_ud) { errno = EBUSY; return -1; }
+	return arm_recv(u, slot);
+}
+
+// Put buffer bid back on the ring. Only addr/len/bid are written: the
+// ring tail shares its slot with bufs[0].resv.
+static void recycle(struct uring_loop *u, unsigned bid) {
+	struct io_uring_buf *b = &u->br->bufs[u->br_tail & (u->nbufs - 1)];
+	b->addr = (uint64_t)(uintptr_t)(u->bufs + (size_t)bid * u->buf_size);
+	b->len = (uint32_t)u->buf_size;
+	b->bid = (uint16_t)bid;
+	u->br_tail++;
+	__atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+}
+
+static void uring_recv_done(struct sc_evloop *ev, const struct sc_event *e) {
+	recycle((struct uring_loop *)ev, e->buf_id);
+}
+
+static int uring_provide_buffers(struct sc_evloop *ev, unsigned n, size_t size) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	if (u->br || n == 0 || (n & (n - 1)) || n > 32768 || size == 0 || size > UINT32_MAX) { errno = EINVAL; return -1; }
+	u->br_len = n * sizeof(struct io_uring_buf);
+	u->br = mmap(NULL, u->br_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	u->bufs = mmap(NULL, n * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)u->br;
+	reg.ring_entries = n;
+	reg.bgid = BUF_GROUP;
+	if (u->br == MAP_FAILED || u->bufs == MAP_FAILED ||
+	    syscall(__NR_io_uring_register, u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		int err = errno;
+		if (u->br != MAP_FAILED) munmap(u->br, u->br_len);
+		if (u->bufs != MAP_FAILED) munmap(u->bufs, n * size);
+		u->br = NULL;
+		u->bufs = NULL;
+		errno = err;
+		return -1;
+	}
+	u->nbufs = n;
+	u->buf_size = size;
+	u->br_tail = 0;
+	for (unsigned i = 0; i < n; ++i) recycle(u, i);
+	return 0;
+}
+
+static int uring_register_buffers(struct sc_evloop *ev, const struct iovec *iov, int n) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	return (int)syscall(__NR_io_uring_register, u->ring_fd, IORING_REGISTER_BUFFERS, iov, n);
+}
+
+static unsigned cq_ready(struct uring_loop *u) {
+	return __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE) - *u->cq_head;
+}
+
+static int uring_wait(struct sc_evloop *ev, struct sc_event *out, int max, int timeout_ms) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	if (cq_ready(u) == 0 && timeout_ms != 0) {
+		unsigned min_complete = 1;
+		if (timeout_ms > 0) {
+			// completes after timeout_ms or as soon as one other CQE is posted
+			struct io_uring_sqe *sqe = get_sqe(u);
+			if (!sqe) {
+				min_complete = 0;   // never block without a deadline
+			} else {
+				u->ts.tv_sec = timeout_ms / 1000;
+				u->ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+				sqe->opcode = IORING_OP_TIMEOUT;
+				sqe->fd = -1;
+				sqe->addr = (uint64_t)(uintptr_t)&u->ts;
+				sqe->len = 1;
+				sqe->off = 1;
+				sqe->user_data = UD_TIMEOUT;
+			}
+		}
+		if (enter(u, min_complete, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != ETIME && errno != EBUSY)
+			return -1;
+	} else if (u->to_submit) {
+		if (enter(u, 0, 0) < 0 && errno != EINTR && errno != EBUSY) return -1;
+	}
+
+	int n = 0;
+	unsigned head = *u->cq_head;
+	unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail && n < max) {
+		struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+		uint64_t ud = cqe->user_data;
+		int res = cqe->res;
+		head++;
+		unsigned flags = cqe->flags;
+		if (ud == UD_TIMEOUT || ud == UD_CANCEL) continue;
+		int slot = (int)(ud & 0xffff);
+		unsigned kind = (unsigned)(ud >> 16) & 0xff;
+		struct uring_slot *s = slot < u->nslots ? &u->slots[slot] : NULL;
+		if (!s || s->fd < 0 || s->gen != (uint32_t)(ud >> 32)) {
+			// removed since; its data goes, the buffer comes back
+			if (flags & IORING_CQE_F_BUFFER) recycle(u, flags >> IORING_CQE_BUFFER_SHIFT);
+			continue;
+		}
+		if (kind == KIND_RECV) {
+			if (!(flags & IORING_CQE_F_MORE)) s->read_ud = 0;
+			if (flags & IORING_CQE_F_BUFFER) {
+				unsigned bid = flags >> IORING_CQE_BUFFER_SHIFT;
+				// a multishot can stop early (CQ overflow): keep it going
+				if (!s->read_ud) arm_recv(u, slot);
+				out[n].data = s->data;
+				out[n].events = SC_EV_RECV;
+				out[n].res = res;
+				out[n].buf = u->bufs + (size_t)bid * u->buf_size;
+				out[n].buf_id = bid;
+				n++;
+				continue;
+			}
+			// out of buffers: the caller returns them before the next
+			// submit, so retrying then finds some (the data waits in the socket)
+			if (res == -ENOBUFS) {
+				if (!s->read_ud) arm_recv(u, slot);
+				continue;
+			}
+			out[n].data = s->data;
+			out[n].events = SC_EV_READ;
+			out[n].res = res;
+			n++;
+			continue;
+		}
+		if (kind == KIND_READ) {
+			s->read_ud = 0;
+			out[n].data = s->data;
+			out[n].events = SC_EV_READ;
+			out[n].res = res;
+			n++;
+			continue;
+		}
+		if (ud != s->poll_ud) continue;  // superseded by mod
+		s->poll_ud = 0;
+		unsigned e = 0;
+		if (res < 0) {
+			if (res == -ECANCELED) continue;
+			e = SC_EV_ERR;
+		} else {
+			if (res & (POLLIN | POLLRDHUP)) e |= SC_EV_IN;
+			if (res & POLLOUT) e |= SC_EV_OUT;
+			if (res & (POLLERR | POLLHUP | POLLNVAL)) e |= SC_EV_ERR;
+		}
+		// keep the interest armed, like level-triggered poll()
+		if (s->events) arm_poll(u, slot);
+		out[n].data = s->data;
+		out[n].events = e;
+		out[n].res = 0;
+		n++;
+	}
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+	return n;
+}
+
+static void uring_destroy(struct sc_evloop *ev) {
+	struct uring_loop *u = (struct uring_loop *)ev;
+	if (u->sqes) munmap(u->sqes, u->sqes_len);
+	if (u->cq_ptr && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_len);
+	if (u->sq_ptr) munmap(u->sq_ptr, u->sq_len);
+	if (u->ring_fd >= 0) close(u->ring_fd);
+	if (u->br) munmap(u->br, u->br_len);
+	if (u->bufs) munmap(u->bufs, (size_t)u->nbufs * u->buf_size);
+	free(u->slots);
+	free(u);
+}
+
+static const struct sc_ev_ops uring_ops = {
+	.add = uring_add,
+	.mod = uring_mod,
+	.del = uring_del,
+	.wait = uring_wait,
+	.register_buffers = uring_register_buffers,
+	.read = uring_read,
+	.provide_buffers = uring_provide_buffers,
+	.recv = uring_recv,
+	.recv_done = uring_recv_done,
+	.destroy = uring_destroy,
+};
+
+struct sc_evloop *sc_ev_uring_create(int max_fds) {
+	struct uring_loop *u = calloc(1, sizeof(*u));
+	if (!u) return NULL;
+	u->base.ops = &uring_ops;
+	u->base.backend = SC_EV_URING;
+	u->ring_fd = -1;
+
+	// one slot per fd, all allocated here so add never allocates
+	u->nslots = max_fds < 1 ? 1 : max_fds > MAX_SLOTS ? MAX_SLOTS : max_fds;
+	u->slots = calloc((size_t)u->nslots, sizeof(*u->slots));
+	if (!u->slots) goto fail;
+	for (int i = 0; i < u->nslots; ++i) u->slots[i].fd = -1;
+
+	// a poll and a read per fd, plus timeout/cancel headroom
+	unsigned entries = 64;
+	while (entries < (unsigned)max_fds * 4 && entries < 4096) entries <<= 1;
+
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	u->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if (u->ring_fd < 0) goto fail;
+
+	u->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	u->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (u->cq_len > u->sq_len) u->sq_len = u->cq_len;
+		u->cq_len = u->sq_len;
+	}
+	u->sq_ptr = mmap(NULL, u->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQ_RING);
+	if (u->sq_ptr == MAP_FAILED) { u->sq_ptr = NULL; goto fail; }
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		u->cq_ptr = u->sq_ptr;
+	} else {
+		u->cq_ptr = mmap(NULL, u->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_CQ_RING);
+		if (u->cq_ptr == MAP_FAILED) { u->cq_ptr = NULL; goto fail; }
+	}
+	u->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->ring_fd, IORING_OFF_SQES);
+	if (u->sqes == MAP_FAILED) { u->sqes = NULL; goto fail; }
+
+	char *sq = u->sq_ptr, *cq = u->cq_ptr;
+	u->sq_head = (unsigned *)(sq + p.sq_off.head);
+	u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	u->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+	u->sq_entries = *(unsigned *)(sq + p.sq_off.ring_entries);
+	u->sq_array = (unsigned *)(sq + p.sq_off.array);
+	u->cq_head = (unsigned *)(cq + p.cq_off.head);
+	u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	u->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return &u->base;
+
+fail:
+	uring_destroy(&u->base);
+	return NULL;
+}
+
+#else
+
+struct sc_evloop *sc_ev_uring_create(int max_fds) {
+	(void)max_fds;
+	errno = ENOTSUP;
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,255 @@
+// feed.c
+// Output fan-out (see feed.h): the shared-memory broadcast ring and the
+// Unix socket subscribers. Everything runs on the thread that encodes
+// the records and never blocks: sockets are non-blocking, a subscriber
+// keeps what its socket did not take in a backlog and is dropped once
+// that is full, and new subscribers are accepted at most every
+// SC_FEED_ACCEPT_MS rather than polled for.
+
+#define _GNU_SOURCE     // accept4
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "sigclient.h"
+
+// An existing ring of that name is stale if the client that published it
+// has exited; anything else there is in use
+static int ring_stale(const char *name) {
+	int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0) return errno == ENOENT;
+	struct sc_feed_page pg;
+	ssize_t n = pread(fd, &pg, sizeof(pg), 0);
+	close(fd);
+	if (n != (ssize_t)sizeof(pg) || memcmp(pg.magic, SC_FEED_MAGIC, 4) != 0 || pg.version != SC_FEED_VERSION)
+		return 0;
+	return pg.pid && kill((pid_t)pg.pid, 0) < 0 && errno == ESRCH;
+}
+
+static int open_ring(struct sc_feed *f, struct sc_arena *a, const char *name, unsigned nslots, int format,
+		long long window_ns, const char *header, size_t header_len, size_t max_record) {
+	f->slot_size = (sizeof(struct sc_feed_slot) + max_record + 63) & ~(size_t)63;
+	size_t off = (sizeof(struct sc_feed_page) + header_len + 63) & ~(size_t)63;
+	f->page_size = (off + (size_t)nslots * f->slot_size + 4095) & ~(size_t)4095;
+	char *own = sc_arena_alloc(a, strlen(name) + 1, 1);
+	if (!own) return -1;
+	strcpy(own, name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0 && errno == EEXIST) {
+		if (!ring_stale(name)) {
+			errno = EADDRINUSE;
+			return -1;
+		}
+		shm_unlink(name);
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	}
+	if (fd < 0) return -1;
+	void *p = MAP_FAILED;
+	if (ftruncate(fd, (off_t)f->page_size) == 0) p = mmap(NULL, f->page_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(name);
+		return -1;
+	}
+	f->shm_name = own;
+	struct sc_feed_page *pg = p;
+	memcpy(pg->magic, SC_FEED_MAGIC, 4);
+	pg->version = SC_FEED_VERSION;
+	pg->pid = (uint32_t)getpid();
+	pg->format = (uint32_t)format;
+	pg->nslots = nslots;
+	pg->slot_size = (uint32_t)f->slot_size;
+	pg->header_size = (uint32_t)header_len;
+	pg->window_ns = window_ns;
+	pg->slots_offset = off;
+	if (header_len) memcpy(pg + 1, header, header_len);
+	f->slots = (char *)p + off;
+	f->mask = nslots - 1;
+	for (unsigned i = 0; i < nslots; ++i)
+		((struct sc_feed_slot *)(f->slots + (size_t)i * f->slot_size))->seq = SC_FEED_WRITING;
+	f->page = pg;
+	return 0;
+}
+
+// A stale socket file from an earlier run is replaced; one that a running
+// client still listens on, or any other file, is not
+static int listen_unix(const char *path) {
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	struct stat st;
+	if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 || errno == EAGAIN) {
+			close(fd);
+			errno = EADDRINUSE;
+			return -1;
+		}
+		unlink(path);
+	}
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SC_FEED_MAX_SUBS) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int sc_feed_open(struct sc_feed *f, struct sc_arena *a, const struct sc_options *opts, int format, long long window_ns,
+		const char *header, size_t header_len, size_t max_record) {
+	memset(f, 0, sizeof(*f));
+	f->listen_fd = -1;
+	for (int i = 0; i < SC_FEED_MAX_SUBS; ++i) f->subs[i].fd = -1;
+	if (header_len) {
+		char *h = sc_arena_alloc(a, header_len, 8);
+		if (!h) return -1;
+		memcpy(h, header, header_len);
+		f->header = h;
+		f->header_len = header_len;
+	}
+	if (opts->feed_shm) {
+		unsigned nslots = opts->feed_slots ? opts->feed_slots : SC_FEED_SLOTS;
+		if (open_ring(f, a, opts->feed_shm, nslots, format, window_ns, header, header_len, max_record) < 0) {
+			fprintf(stderr, "sigclient: feed ring %s: %s\n", opts->feed_shm, strerror(errno));
+			return -1;
+		}
+	}
+	if (opts->feed_unix) {
+		f->listen_fd = listen_unix(opts->feed_unix);
+		f->path = f->listen_fd >= 0 ? strdup(opts->feed_unix) : NULL;
+		if (!f->path) {
+			fprintf(stderr, "sigclient: feed socket %s: %s\n", opts->feed_unix, strerror(errno));
+			sc_feed_close(f);
+			return -1;
+		}
+		for (int i = 0; i < SC_FEED_MAX_SUBS; ++i) {
+			f->subs[i].backlog = sc_arena_alloc(a, SC_FEED_BACKLOG, 64);
+			if (!f->subs[i].backlog) {
+				sc_feed_close(f);
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+void sc_feed_close(struct sc_feed *f) {
+	if (f->page) munmap(f->page, f->page_size);
+	if (f->shm_name) shm_unlink(f->shm_name);
+	for (int i = 0; i < SC_FEED_MAX_SUBS; ++i)
+		if (f->subs[i].fd >= 0) close(f->subs[i].fd);
+	if (f->listen_fd >= 0) {
+		close(f->listen_fd);
+		unlink(f->path);
+	}
+	free(f->path);
+	if (f->served)
+		fprintf(stderr, "sigclient: feed: %lld subscribers served, %lld dropped for falling behind\n",
+			f->served, f->dropped);
+	memset(f, 0, sizeof(*f));
+	f->listen_fd = -1;
+}
+
+static void drop_sub(struct sc_feed_sub *s) {
+	close(s->fd);
+	s->fd = -1;
+	s->len = 0;
+}
+
+// Send the backlog and then buf; what the socket does not take is kept.
+// Returns -1 if the subscriber is gone, or with ENOBUFS if its backlog
+// would overflow.
+static int send_sub(struct sc_feed_sub *s, const char *buf, size_t len) {
+	while (s->len) {
+		ssize_t w = send(s->fd, s->backlog, s->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (w < 0) {
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN) return -1;
+			break;
+		}
+		memmove(s->backlog, s->backlog + w, s->len - (size_t)w);
+		s->len -= (size_t)w;
+	}
+	if (!s->len) {
+		while (len) {
+			ssize_t w = send(s->fd, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+			if (w < 0) {
+				if (errno == EINTR) continue;
+				if (errno != EAGAIN) return -1;
+				break;
+			}
+			buf += w;
+			len -= (size_t)w;
+		}
+	}
+	if (s->len + len > SC_FEED_BACKLOG) {
+		errno = ENOBUFS;
+		return -1;
+	}
+	memcpy(s->backlog + s->len, buf, len);
+	s->len += len;
+	return 0;
+}
+
+// New subscribers start with the schema header (binary output) and then
+// get every record from the next one on
+static void accept_subs(struct sc_feed *f) {
+	int fd;
+	while ((fd = accept4(f->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		struct sc_feed_sub *s = NULL;
+		for (int i = 0; i < SC_FEED_MAX_SUBS && !s; ++i)
+			if (f->subs[i].fd < 0) s = &f->subs[i];
+		if (!s) {
+			close(fd);
+			continue;
+		}
+		s->fd = fd;
+		s->len = 0;
+		f->served++;
+		if (f->header_len && send_sub(s, f->header, f->header_len) < 0) drop_sub(s);
+	}
+}
+
+// Seqlock write of record n into its slot, then advance head
+static void put_ring(struct sc_feed *f, const char *rec, size_t len) {
+	struct sc_feed_page *pg = f->page;
+	uint64_t n = pg->head;
+	struct sc_feed_slot *slot = (struct sc_feed_slot *)(f->slots + (size_t)(n & f->mask) * f->slot_size);
+	if (len > f->slot_size - sizeof(*slot)) len = f->slot_size - sizeof(*slot);
+	__atomic_store_n(&slot->seq, SC_FEED_WRITING, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->len = (uint32_t)len;
+	memcpy(slot + 1, rec, len);
+	__atomic_store_n(&slot->seq, n, __ATOMIC_RELEASE);
+	__atomic_store_n(&pg->head, n + 1, __ATOMIC_RELEASE);
+}
+
+// One encoded record (a JSON line or a binary record) to every reader
+void sc_feed_publish(struct sc_feed *f, const char *rec, size_t len) {
+	if (f->page) put_ring(f, rec, len);
+	if (f->listen_fd < 0) return;
+	long long now = sc_mono_ms();
+	if (now >= f->next_accept_ms) {
+		accept_subs(f);
+		f->next_accept_ms = now + SC_FEED_ACCEPT_MS;
+	}
+	for (int i = 0; i < SC_FEED_MAX_SUBS; ++i) {
+		struct sc_feed_sub *s = &f->subs[i];
+		if (s->fd < 0 || send_sub(s, rec, len) == 0) continue;
+		if (errno == ENOBUFS) f->dropped++;
+		drop_sub(s);
+	}
+}
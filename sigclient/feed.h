@@ -0,0 +1,58 @@
+// feed.h
+// Output fan-out (-P): every record the client writes is also published,
+// once, into a shared-memory broadcast ring that any number of readers
+// follow with their own cursors (analyzer/scfeed.py), and/or sent to the
+// subscribers of a Unix-domain stream socket. The writer never waits for
+// a reader: a ring reader that falls behind by more than the ring loses
+// the oldest records, a socket subscriber that falls behind by more than
+// its backlog is disconnected.
+//
+// Ring layout (shm_open name), native endianness:
+//
+//   struct sc_feed_page
+//   header_size bytes: the binary output's schema header (binfmt.h), if any
+//   padding to 64 bytes
+//   nslots x slot_size bytes: struct sc_feed_slot + record
+//
+// Record n (0, 1, ...) goes to slot n % nslots. A slot's seq is the
+// record it holds, or SC_FEED_WRITING while it is rewritten; a reader
+// copies the record, then checks seq again and drops the copy if it
+// changed. head is the number of records published.
+//
+// A client does not take over the name of a ring that another running
+// client publishes; one left behind by a client that is gone is replaced.
+
+#ifndef SIGCLIENT_FEED_H
+#define SIGCLIENT_FEED_H
+
+#include <stdint.h>
+
+#define SC_FEED_MAGIC "SCF1"
+#define SC_FEED_VERSION 2
+#define SC_FEED_WRITING UINT64_MAX
+#define SC_FEED_SLOTS 1024          // default ring size (records)
+#define SC_FEED_MAX_SUBS 8          // Unix socket subscribers at a time
+#define SC_FEED_BACKLOG (256 << 10) // per subscriber, unsent bytes before it is dropped
+#define SC_FEED_ACCEPT_MS 100       // how often new subscribers are accepted
+
+struct sc_feed_page {
+	char magic[4];
+	uint32_t version;
+	uint32_t format;            // enum sc_out_format: 0 JSON lines, 1 binary records
+	uint32_t nslots;            // a power of two
+	uint32_t slot_size;         // struct sc_feed_slot included
+	uint32_t header_size;
+	uint32_t pid;               // of the client publishing it
+	uint32_t pad;
+	int64_t window_ns;
+	uint64_t slots_offset;      // from the start of the page
+	uint64_t head;              // records published
+};
+
+struct sc_feed_slot {
+	uint64_t seq;
+	uint32_t len;               // record bytes after this struct
+	uint32_t pad;
+};
+
+#endif
@@ -0,0 +1,193 @@
+// metrics.c
+// Snapshot side of the loop instrumentation (see metrics.h): setting up
+// each loop's live counters, the shared-memory page, and the periodic
+// copies to it and to stderr.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "sigclient.h"
+
+uint64_t sc_hist_quantile(const struct sc_hist *h, double q) {
+	if (h->count == 0) return 0;
+	uint64_t want = (uint64_t)(q * (double)h->count + 0.5), seen = 0;
+	if (want < 1) want = 1;
+	for (int i = 0; i < SC_HIST_BUCKETS; ++i) {
+		seen += h->bucket[i];
+		if (seen >= want) return sc_hist_lower(i);
+	}
+	return h->max_ns;
+}
+
+static size_t section_size(int nstreams) {
+	size_t n = sizeof(struct sc_metrics_section) + (size_t)nstreams * sizeof(struct sc_metrics_stream);
+	return (n + 63) & ~(size_t)63;
+}
+
+static struct sc_metrics_page *open_page(const char *name, int nloops, int nstreams, long long interval_ns, size_t *size) {
+	*size = sizeof(struct sc_metrics_page) + (size_t)nloops * section_size(nstreams);
+	*size = (*size + 4095) & ~(size_t)4095;
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) return NULL;
+	void *p = MAP_FAILED;
+	if (ftruncate(fd, (off_t)*size) == 0) p = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		shm_unlink(name);
+		return NULL;
+	}
+	struct sc_metrics_page *pg = p;
+	memcpy(pg->magic, SC_METRICS_MAGIC, 4);
+	pg->version = SC_METRICS_VERSION;
+	pg->nloops = (uint32_t)nloops;
+	pg->section_size = (uint32_t)section_size(nstreams);
+	pg->interval_ns = interval_ns;
+	pg->start_ns = (int64_t)sc_epoch_ms_now() * 1000000LL;
+	return pg;
+}
+
+// Live metrics of loop c, which owns streams [0, n) of its tables (none
+// for a merge-only tick loop)
+static int loop_init(struct sc_client *c, const struct sc_options *opts, int index, int n,
+		struct sc_metrics_page *pg, long long first_ns) {
+	struct sc_metrics *m = sc_arena_array(c->arena, 1, sizeof(*m));
+	if (!m) return -1;
+	c->metrics = m;
+	m->index = index;
+	m->nstreams = n;
+	m->streams = sc_arena_array(c->arena, n + 1, sizeof(*m->streams));
+	m->prev = sc_arena_array(c->arena, n + 1, sizeof(*m->prev));
+	if (!m->streams || !m->prev) return -1;
+	for (int i = 0; i < n; ++i) {
+		snprintf(m->streams[i].name, sizeof(m->streams[i].name), "%s", c->streams[i].name);
+		m->streams[i].inbuf = (uint64_t)c->conns[i].cap;
+		c->conns[i].metrics = &m->streams[i];
+	}
+	m->interval_ns = opts->metrics_ns;
+	m->to_stderr = opts->metrics_stderr;
+	m->next_ns = first_ns + m->interval_ns;
+	m->last_ns = first_ns;
+	if (pg) {
+		m->section = (struct sc_metrics_section *)((char *)(pg + 1) + (size_t)index * pg->section_size);
+		m->section->first = (uint32_t)c->base;
+		m->section->nstreams = (uint32_t)n;
+	}
+	return 0;
+}
+
+int sc_metrics_init(struct sc_client *c, const struct sc_options *opts) {
+	if (!opts->metrics_ns) return 0;
+	int nloops = 1 + c->nshards;
+	struct sc_metrics_page *pg = NULL;
+	if (opts->metrics_shm) {
+		pg = open_page(opts->metrics_shm, nloops, c->nconns, opts->metrics_ns, &c->metrics_page_size);
+		if (!pg) {
+			fprintf(stderr, "sigclient: metrics page %s: %s\n", opts->metrics_shm, strerror(errno));
+			return -1;
+		}
+		c->metrics_page = pg;
+		c->metrics_name = strdup(opts->metrics_shm);
+		if (!c->metrics_name) return -1;
+	}
+	long long now_ns = sc_mono_ns();
+	if (loop_init(c, opts, 0, c->nshards ? 0 : c->nconns, pg, now_ns) < 0) return -1;
+	for (int k = 0; k < c->nshards; ++k) {
+		struct sc_client *w = &c->shards[k].client;
+		if (loop_init(w, opts, k + 1, w->nconns, pg, now_ns) < 0) return -1;
+	}
+	return 0;
+}
+
+static void loop_free(struct sc_client *c) {
+	struct sc_metrics *m = c->metrics;
+	if (!m) return;
+	for (int i = 0; i < m->nstreams; ++i) c->conns[i].metrics = NULL;
+	c->metrics = NULL;     // the memory goes with the arena
+}
+
+void sc_metrics_free(struct sc_client *c) {
+	loop_free(c);
+	for (int k = 0; k < c->nshards; ++k) loop_free(&c->shards[k].client);
+	if (c->metrics_page) munmap(c->metrics_page, c->metrics_page_size);
+	if (c->metrics_name) shm_unlink(c->metrics_name);
+	free(c->metrics_name);
+	c->metrics_page = NULL;
+	c->metrics_name = NULL;
+}
+
+static void print_hist(const char *what, const struct sc_hist *h) {
+	if (!h->count) return;
+	fprintf(stderr, ", %s us p50 %.1f p99 %.1f max %.1f", what,
+		(double)sc_hist_quantile(h, 0.5) / 1e3, (double)sc_hist_quantile(h, 0.99) / 1e3, (double)h->max_ns / 1e3);
+}
+
+static void print_snapshot(struct sc_metrics *m, long long now_ns) {
+	static const char *const names[SC_HIST_NKINDS] = { "late", "parse", "format", "flush" };
+	const struct sc_metrics_loop *l = &m->loop;
+	fprintf(stderr, "sigclient: metrics loop %d: %llu ticks (%llu skipped), %llu wakeups, %llu events",
+		m->index, (unsigned long long)l->ticks, (unsigned long long)l->skipped,
+		(unsigned long long)l->wakeups, (unsigned long long)l->events);
+	for (int k = 0; k < SC_HIST_NKINDS; ++k) print_hist(names[k], &l->hist[k]);
+	fputc('\n', stderr);
+
+	double secs = (double)(now_ns - m->last_ns) / 1e9;
+	for (int i = 0; i < m->nstreams; ++i) {
+		const struct sc_metrics_stream *s = &m->streams[i], *p = &m->prev[i];
+		fprintf(stderr, "sigclient: metrics %s: %.0f B/s, %.1f samples/s, %llu of %llu windows absent, %llu connects, %llu drops, "
+			"%.1f reads/s, %llu B buffer, %llu truncated, rtt us %llu +- %llu\n",
+			s->name, secs > 0 ? (double)(s->bytes - p->bytes) / secs : 0.0,
+			secs > 0 ? (double)(s->samples - p->samples) / secs : 0.0,
+			(unsigned long long)(s->absent - p->absent), (unsigned long long)(s->windows - p->windows),
+			(unsigned long long)s->connects, (unsigned long long)s->drops,
+			secs > 0 ? (double)(s->reads - p->reads) / secs : 0.0,
+			(unsigned long long)s->inbuf, (unsigned long long)s->truncated,
+			(unsigned long long)s->rtt_us, (unsigned long long)s->rttvar_us);
+	}
+}
+
+// Seqlock write of the loop's section
+static void publish(struct sc_metrics *m) {
+	struct sc_metrics_section *sec = m->section;
+	uint64_t seq = sec->seq;
+	__atomic_store_n(&sec->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	sec->snapshot_ns = (int64_t)sc_epoch_ms_now() * 1000000LL;
+	sec->loop = m->loop;
+	memcpy(sec + 1, m->streams, (size_t)m->nstreams * sizeof(*m->streams));
+	__atomic_store_n(&sec->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Round trip to each stream's host as the kernel measures it from ACKs,
+// which is what separates hosts that are near from far ones
+static void sample_rtt(struct sc_client *c, struct sc_metrics *m) {
+	for (int i = 0; i < m->nstreams; ++i) {
+		struct tcp_info ti;
+		socklen_t len = sizeof(ti);
+		const struct sc_conn *conn = &c->conns[i];
+		m->streams[i].rtt_us = m->streams[i].rttvar_us = 0;
+		if (conn->state != SC_CONN_UP || getsockopt(conn->fd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0) continue;
+		m->streams[i].rtt_us = ti.tcpi_rtt;
+		m->streams[i].rttvar_us = ti.tcpi_rttvar;
+	}
+}
+
+void sc_metrics_snapshot(struct sc_client *c, long long now_ns) {
+	struct sc_metrics *m = c->metrics;
+	m->loop.ticks = (uint64_t)c->sched.ticks;
+	m->loop.skipped = (uint64_t)c->sched.skipped;
+	sample_rtt(c, m);
+	if (m->section) publish(m);
+	if (m->to_stderr) print_snapshot(m, now_ns);
+	memcpy(m->prev, m->streams, (size_t)m->nstreams * sizeof(*m->streams));
+	m->last_ns = now_ns;
+	while (m->next_ns <= now_ns) m->next_ns += m->interval_ns;
+}
@@ -0,0 +1,113 @@
+// metrics.h
+// Loop instrumentation (-M): per-stream counters and log-linear latency
+// histograms, updated in place by the loop that owns them. Nothing is
+// shared while they count; at most once per snapshot interval, at its
+// tick, each loop prints them to stderr and/or copies them into its
+// section of a shared-memory page (shm_open name), where a reader
+// (analyzer/scmetrics.py) picks them up without touching the loop.
+//
+// Page layout, native endianness:
+//
+//   struct sc_metrics_page
+//   nloops x section_size bytes:
+//     struct sc_metrics_section      seqlock: seq is odd while the loop
+//     nstreams x struct sc_metrics_stream   rewrites the section
+//
+// Section 0 is the tick loop, 1.. the shard workers (-j).
+//
+// Histograms bucket nanoseconds HDR-style: below 2^SC_HIST_SUB_BITS each
+// value has a bucket, above that every power of two is split into
+// 2^SC_HIST_SUB_BITS buckets, so a bucket's width is at most 1/8 of its
+// lower bound.
+
+#ifndef SIGCLIENT_METRICS_H
+#define SIGCLIENT_METRICS_H
+
+#include <stdint.h>
+
+#define SC_METRICS_MAGIC "SCM1"
+#define SC_METRICS_VERSION 3
+#define SC_HIST_SUB_BITS 3
+#define SC_HIST_OCTAVES 40      // values up to ~2^40 ns (18 min), larger clamp
+#define SC_HIST_BUCKETS ((SC_HIST_OCTAVES + 1) << SC_HIST_SUB_BITS)
+#define SC_METRICS_NAME_MAX 32
+
+// What the histograms of a loop time
+enum {
+	SC_HIST_LATE,       // tick fire time - scheduled time
+	SC_HIST_PARSE,      // handling one socket event: read, tokenize, parse
+	SC_HIST_FORMAT,     // encoding a tick's record
+	SC_HIST_FLUSH,      // writing buffered output
+	SC_HIST_NKINDS,
+};
+
+struct sc_hist {
+	uint64_t count, sum_ns, max_ns;
+	uint32_t bucket[SC_HIST_BUCKETS];     // SC_HIST_BUCKETS is a multiple of 8
+};
+
+struct sc_metrics_stream {
+	char name[SC_METRICS_NAME_MAX];
+	uint64_t bytes;         // received
+	uint64_t samples;       // lines received
+	uint64_t windows;       // windows ended
+	uint64_t absent;        // ... without a value ("--")
+	uint64_t connects;      // connections established
+	uint64_t drops;         // connections lost or failed
+	uint64_t reads;         // reads that returned data
+	uint64_t truncated;     // values cut to SC_TOKEN_MAX, lines dropped at SC_BUF_MAX
+	uint64_t inbuf;         // current input buffer size (bytes)
+	uint64_t rtt_us;        // kernel's smoothed TCP round trip to the host, 0 if down
+	uint64_t rttvar_us;     // ... and its variation
+};
+
+struct sc_metrics_loop {
+	uint64_t ticks, skipped;    // see struct sc_sched
+	uint64_t wakeups;           // waits on the backend
+	uint64_t events;            // socket events handled
+	struct sc_hist hist[SC_HIST_NKINDS];
+};
+
+struct sc_metrics_section {
+	uint64_t seq;
+	int64_t snapshot_ns;        // epoch time of the snapshot
+	uint32_t first;             // merged index of the first stream
+	uint32_t nstreams;
+	struct sc_metrics_loop loop;
+};
+
+struct sc_metrics_page {
+	char magic[4];
+	uint32_t version;
+	uint32_t nloops;
+	uint32_t section_size;
+	int64_t interval_ns;
+	int64_t start_ns;           // epoch time the page was created
+};
+
+static inline int sc_hist_index(uint64_t v) {
+	if (v < (1u << SC_HIST_SUB_BITS)) return (int)v;
+	int shift = 63 - __builtin_clzll(v) - SC_HIST_SUB_BITS;
+	int i = ((shift + 1) << SC_HIST_SUB_BITS) + (int)((v >> shift) & ((1u << SC_HIST_SUB_BITS) - 1));
+	return i < SC_HIST_BUCKETS ? i : SC_HIST_BUCKETS - 1;
+}
+
+// Smallest value of bucket i
+static inline uint64_t sc_hist_lower(int i) {
+	if (i < (1 << SC_HIST_SUB_BITS)) return (uint64_t)i;
+	int shift = (i >> SC_HIST_SUB_BITS) - 1;
+	return (uint64_t)((1 << SC_HIST_SUB_BITS) + (i & ((1 << SC_HIST_SUB_BITS) - 1))) << shift;
+}
+
+static inline void sc_hist_add(struct sc_hist *h, long long ns) {
+	uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+	h->count++;
+	h->sum_ns += v;
+	if (v > h->max_ns) h->max_ns = v;
+	h->bucket[sc_hist_index(v)]++;
+}
+
+// Value at quantile q (0..1): the lower bound of the bucket reaching it
+uint64_t sc_hist_quantile(const struct sc_hist *h, double q);
+
+#endif
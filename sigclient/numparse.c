@@ -0,0 +1,108 @@
+// numparse.c
+// Fast path for the short decimals the servers send ("-6.2", "4.95"):
+// accumulate up to 19 significant digits in an integer and scale by an
+// exact power of ten. When the mantissa fits in 53 bits and the scale is
+// at most 1e22 both operands are exact, so one IEEE multiply or divide
+// gives the correctly rounded result (Clinger's fast path). Anything
+// else (long mantissas, large exponents, inf/nan) goes to strtod on a
+// copy of up to SC_TOKEN_MAX bytes (longer input is SC_ABSENT); the clients never call setlocale(), so that runs in the
+// "C" locale and still uses '.' as the decimal point.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "numparse.h"
+#include "sigclient.h"
+
+#define MAX_DIGITS 19
+#define FAST_MANTISSA (1ULL << 53)
+
+static const double pow10_exact[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline int is_digit(char ch) {
+	return (unsigned char)(ch - '0') < 10;
+}
+
+static size_t parse_slow(const char *s, size_t len, double *out) {
+	char tmp[SC_TOKEN_MAX + 1];
+	if (len >= sizeof(tmp)) {
+		// cutting it could drop digits or the exponent: no value beats a wrong one
+		*out = SC_ABSENT;
+		return 0;
+	}
+	memcpy(tmp, s, len);
+	tmp[len] = '\0';
+	char *end;
+	double v = strtod(tmp, &end);
+	if (end == tmp) {
+		*out = SC_ABSENT;
+		return 0;
+	}
+	*out = v;
+	return (size_t)(end - tmp);
+}
+
+size_t sc_parse_double(const char *s, size_t len, double *out) {
+	size_t i = 0;
+	int neg = 0;
+	if (i < len && (s[i] == '+' || s[i] == '-')) neg = s[i++] == '-';
+
+	uint64_t m = 0;
+	int sig = 0, exp10 = 0, ndigits = 0, inexact = 0;
+	for (; i < len && is_digit(s[i]); ++i, ++ndigits) {
+		int d = s[i] - '0';
+		if (sig < MAX_DIGITS) {
+			m = m * 10 + d;
+			if (m) sig++;
+		} else {
+			exp10++;
+			if (d) inexact = 1;
+		}
+	}
+	if (i < len && s[i] == '.') {
+		size_t dot = i++;
+		for (; i < len && is_digit(s[i]); ++i, ++ndigits) {
+			int d = s[i] - '0';
+			if (sig < MAX_DIGITS) {
+				m = m * 10 + d;
+				if (m) sig++;
+				exp10--;
+			} else if (d) {
+				inexact = 1;
+			}
+		}
+		if (ndigits == 0) i = dot;
+	}
+	if (ndigits == 0) return parse_slow(s, len, out);  // inf, nan, or not a number
+
+	if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+		size_t j = i + 1;
+		int eneg = 0, e = 0;
+		if (j < len && (s[j] == '+' || s[j] == '-')) eneg = s[j++] == '-';
+		if (j < len && is_digit(s[j])) {
+			for (; j < len && is_digit(s[j]); ++j)
+				if (e < 100000) e = e * 10 + (s[j] - '0');
+			exp10 += eneg ? -e : e;
+			i = j;
+		}
+	}
+
+	if (inexact || m > FAST_MANTISSA || exp10 < -22 || exp10 > 22) return parse_slow(s, i, out);
+
+	double v = (double)m;
+	v = exp10 < 0 ? v / pow10_exact[-exp10] : v * pow10_exact[exp10];
+	*out = neg ? -v : v;
+	return i;
+}
+
+int sc_format_double(char *buf, size_t size, double v) {
+	int n = snprintf(buf, size, "%.15g", v);
+	if (n > 0 && (size_t)n < size && strtod(buf, NULL) == v) return n;
+	return snprintf(buf, size, "%.17g", v);
+}
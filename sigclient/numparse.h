@@ -0,0 +1,24 @@
+// numparse.h
+// Locale-independent decimal float parser for sample values.
+
+#ifndef SIGCLIENT_NUMPARSE_H
+#define SIGCLIENT_NUMPARSE_H
+
+#include <math.h>
+#include <stddef.h>
+
+// Marks "no sample in this window" (printed as "--" / null)
+#define SC_ABSENT NAN
+
+// Parse [+-]digits[.digits][(e|E)[+-]digits] from s[0..len). Stores the
+// value and returns the number of characters consumed, or 0 (value set
+// to SC_ABSENT) if s does not start with a number, or if it needs strtod
+// and is longer than SC_TOKEN_MAX. Like strtod, trailing characters are
+// ignored.
+size_t sc_parse_double(const char *s, size_t len, double *out);
+
+// Shortest of %.15g / %.17g that reads back as v, so a parsed "-6.2"
+// prints as -6.2. Returns the snprintf result.
+int sc_format_double(char *buf, size_t size, double v);
+
+#endif
@@ -0,0 +1,639 @@
+// options.c
+// Command line / environment / config file settings common to both clients.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "sigclient.h"
+
+static void usage(const char *prog) {
+	fprintf(stderr,
+		"usage: %s [-Elnu] [-R rules] [-L limit] [-S idle[,busy=us]] [-M interval[,stderr][,shm=name]] [-A kernel|loop[,interp]] [-j shards] [-T policy[,slots]] [-P publish] [-F interval[,n=N]] [-O sockopts] [-o json|bin] [-C dir [-r rotate]] [-w window] [-f flush] [-a fields] [-b poll|epoll|uring] [-c file] [-s [name=][host:]port[/fields][@sockopts]]...\n"
+		"  -b backend   event backend (default %s, env SIGCLIENT_BACKEND)\n"
+		"  -c file      read stream specs from file, one per line ('#' comments)\n"
+		"  -s spec      add a stream; name defaults to outN, host to %s; host is\n"
+		"               a name, an IPv4 address or [IPv6]\n"
+		"               (default: out1..out3 on ports 4001..4003)\n"
+		"  -O sockopts  TCP options for streams without their own @sockopts:\n"
+		"               nodelay,quickack,keepalive[=idle[:intvl[:count]]],\n"
+		"               tos=N or none\n"
+		"  -A stamps    assign samples to windows by arrival time, stamped by the\n"
+		"               kernel on receipt (poll/epoll) or by the loop per wakeup;\n"
+		"               ,interp estimates numeric values at the window end\n"
+		"  -j shards    split the streams across this many worker threads,\n"
+		"               each pinned to a CPU with its own event loop\n"
+		"  -T policy    write output from a separate thread through a ring of\n"
+		"               slots records (default 1024); when it is full:\n"
+		"               block, drop-oldest or drop-newest\n"
+		"  -P publish   also publish every record to other readers:\n"
+		"               shm=name[,slots=N] for a shared-memory ring of N\n"
+		"               records (default 1024, analyzer/scfeed.py) and/or\n"
+		"               unix=path for a Unix socket any reader can connect to\n"
+		"  -F interval[,n=N]\n"
+		"               streaming analysis on a background thread: every\n"
+		"               interval, a line with each stream's dominant frequency,\n"
+		"               peak-to-peak, RMS and shape over its last N windows\n"
+		"               (default 256, a power of two); JSON output only\n"
+		"  -o format    output format: json lines (default) or bin records\n"
+		"  -C dir       capture binary records into mmapped segment files in dir\n"
+		"  -r rotate    start a new segment at size=BYTES[k|M|G] and/or\n"
+		"               time=DURATION, comma-separated (default size=64M)\n"
+		"  -w window    window length with unit ns, us, ms (default) or s,\n"
+		"               e.g. 500us or 2.5ms; at least 1us\n"
+		"  -u           microsecond timestamps (\"timestamp_us\")\n"
+		"  -f flush     when to write output: tick (default), ticks=N,\n"
+		"               size=BYTES or deadline=DURATION (checked per tick)\n"
+		"  -S idle[,busy=us]\n"
+		"               spin mode: poll without sleeping, pinned to a core,\n"
+		"               until idle (a duration) passes without events; busy=\n"
+		"               sets SO_BUSY_POLL on the stream sockets (default 50)\n"
+		"  -M interval[,stderr][,shm=name]\n"
+		"               loop metrics (rates, absent windows, reconnects,\n"
+		"               latency histograms) every interval, on stderr or in\n"
+		"               the shared-memory page name (analyzer/scmetrics.py)\n"
+		"  -R file      client2: control rule table (see sigclient/rules.h)\n"
+		"  -L limit     client2: per-target control write limit, a minimum\n"
+		"               interval (e.g. 100ms) or a token bucket N/s[,burst]\n"
+		"  -E           client2: evaluate the control rules as each sample\n"
+		"               arrives instead of once per tick\n"
+		"  -n           numeric output: values as JSON numbers, null if none\n"
+		"  -l           add each tick's lateness (\"late_us\") to the output\n"
+		"  -a fields    per-window aggregates for streams without their own\n"
+		"               /fields: count,min,max,mean,var,first,last, all or none\n",
+		prog, sc_ev_backend_name(sc_ev_default_backend()), SC_DEFAULT_HOST);
+}
+
+void sc_options_init(struct sc_options *o) {
+	memset(o, 0, sizeof(*o));
+	o->backend = sc_ev_default_backend();
+	const char *env = getenv("SIGCLIENT_BACKEND");
+	if (env && sc_ev_backend_parse(env, &o->backend) < 0)
+		fprintf(stderr, "sigclient: ignoring unknown SIGCLIENT_BACKEND '%s'\n", env);
+}
+
+void sc_options_free(struct sc_options *o) {
+	free(o->capture_dir);
+	o->capture_dir = NULL;
+	free(o->rules_path);
+	o->rules_path = NULL;
+	free(o->metrics_shm);
+	o->metrics_shm = NULL;
+	free(o->feed_shm);
+	o->feed_shm = NULL;
+	free(o->feed_unix);
+	o->feed_unix = NULL;
+	free(o->streams);
+	o->streams = NULL;
+	o->nstreams = 0;
+}
+
+// Names become JSON keys, so keep them to a safe character set
+static int valid_name(const char *s) {
+	if (!*s) return 0;
+	for (; *s; ++s)
+		if (!isalnum((unsigned char)*s) && *s != '_' && *s != '-' && *s != '.') return 0;
+	return 1;
+}
+
+// Parse a socket option list, comma-separated: nodelay, quickack,
+// keepalive[=idle[:interval[:count]]] (seconds), tos=N, or none.
+// Returns 0 or -1 on a bad list.
+int sc_options_parse_sockopts(const char *s, struct sc_sockopts *out) {
+	struct sc_sockopts o;
+	memset(&o, 0, sizeof(o));
+	char buf[128];
+	if (!*s || strlen(s) >= sizeof(buf)) return -1;
+	strcpy(buf, s);
+	for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		char *end;
+		if (strcmp(tok, "none") == 0) {
+			memset(&o, 0, sizeof(o));
+		} else if (strcmp(tok, "nodelay") == 0) {
+			o.flags |= SC_SOCK_NODELAY;
+		} else if (strcmp(tok, "quickack") == 0) {
+			o.flags |= SC_SOCK_QUICKACK;
+		} else if (strncmp(tok, "keepalive", 9) == 0 && (tok[9] == '\0' || tok[9] == '=')) {
+			o.flags |= SC_SOCK_KEEPALIVE;
+			int *vals[3] = { &o.keep_idle_s, &o.keep_intvl_s, &o.keep_count };
+			const char *p = tok + 9;
+			for (int k = 0; k < 3 && *p; ++k) {
+				if (*p != (k ? ':' : '=')) return -1;
+				long v = strtol(p + 1, &end, 10);
+				if (end == p + 1 || v < 1 || v > 32767) return -1;
+				*vals[k] = (int)v;
+				p = end;
+			}
+			if (*p) return -1;
+		} else if (strncmp(tok, "tos=", 4) == 0) {
+			long v = strtol(tok + 4, &end, 0);
+			if (end == tok + 4 || *end != '\0' || v < 0 || v > 255) return -1;
+			o.flags |= SC_SOCK_TOS;
+			o.tos = (int)v;
+		} else {
+			return -1;
+		}
+	}
+	*out = o;
+	return 0;
+}
+
+// Parse "[name=][host:]port[/fields][@sockopts]" and append it. An IPv6
+// host goes in brackets ("[::1]:4001"). Returns 0 or -1 on a bad spec.
+int sc_options_add_stream(struct sc_options *o, const char *spec) {
+	struct sc_stream_spec st;
+	memset(&st, 0, sizeof(st));
+
+	const char *eq = strchr(spec, '=');
+	const char *at = strchr(spec, '@');
+	if (eq && (!at || eq < at)) {
+		size_t len = eq - spec;
+		if (len >= sizeof(st.name)) return -1;
+		memcpy(st.name, spec, len);
+		if (!valid_name(st.name)) return -1;
+		spec = eq + 1;
+	} else {
+		snprintf(st.name, sizeof(st.name), "out%d", o->nstreams + 1);
+	}
+
+	char addr[SC_HOST_MAX + 8];
+	size_t len = at ? (size_t)(at - spec) : strlen(spec);
+	if (len >= sizeof(addr)) return -1;
+	memcpy(addr, spec, len);
+	addr[len] = '\0';
+	if (at) {
+		if (sc_options_parse_sockopts(at + 1, &st.sock) < 0) return -1;
+		st.sock_set = 1;
+	}
+
+	char *slash = strchr(addr, '/');
+	if (slash) {
+		*slash++ = '\0';
+		if (sc_stats_parse_fields(slash, strlen(slash), &st.agg) < 0 || *slash == '\0') return -1;
+		st.agg_set = 1;
+	}
+
+	const char *port = addr;
+	if (addr[0] == '[') {
+		char *close = strchr(addr, ']');
+		if (!close || close == addr + 1 || close[1] != ':') return -1;
+		*close = '\0';
+		if ((size_t)(close - addr) > sizeof(st.host)) return -1;
+		memcpy(st.host, addr + 1, close - addr);
+		port = close + 2;
+	} else {
+		const char *colon = strchr(addr, ':');
+		if (colon) {
+			len = colon - addr;
+			// more colons: an IPv6 address without brackets
+			if (len == 0 || len >= sizeof(st.host) || strchr(colon + 1, ':')) return -1;
+			memcpy(st.host, addr, len);
+			port = colon + 1;
+		} else {
+			snprintf(st.host, sizeof(st.host), "%s", SC_DEFAULT_HOST);
+		}
+	}
+
+	char *end;
+	long p = strtol(port, &end, 10);
+	if (end == port || *end != '\0' || p <= 0 || p > 65535) return -1;
+	st.port = (int)p;
+
+	for (int i = 0; i < o->nstreams; ++i)
+		if (strcmp(o->streams[i].name, st.name) == 0) return -1;
+
+	struct sc_stream_spec *arr = realloc(o->streams, (o->nstreams + 1) * sizeof(*arr));
+	if (!arr) return -1;
+	o->streams = arr;
+	o->streams[o->nstreams++] = st;
+	return 0;
+}
+
+// Parse "<number>[ns|us|ms|s]" (default ms) into nanoseconds
+static int parse_duration(const char *s, long long *out) {
+	static const struct { const char *unit; double ns; } units[] = {
+		{ "ns", 1 }, { "us", 1e3 }, { "ms", 1e6 }, { "s", 1e9 },
+		{ "min", 60e9 }, { "h", 3600e9 }, { "", 1e6 },
+	};
+	double v;
+	size_t n = sc_parse_double(s, strlen(s), &v);
+	if (n == 0 || !(v > 0)) return -1;
+	for (size_t i = 0; i < sizeof(units) / sizeof(units[0]); ++i) {
+		if (strcmp(s + n, units[i].unit) != 0) continue;
+		double ns = v * units[i].ns + 0.5;
+		if (ns < 1 || ns > 1e18) return -1;
+		*out = (long long)ns;
+		return 0;
+	}
+	return -1;
+}
+
+// Parse -L "100ms" (one write per interval) or "20/s[,burst]"
+static int parse_limit(const char *s, struct sc_options *o) {
+	const char *slash = strstr(s, "/s");
+	if (!slash) {
+		long long ns;
+		if (parse_duration(s, &ns) < 0) return -1;
+		o->ctrl_rate = 1e9 / (double)ns;
+		o->ctrl_burst = 1;
+		return 0;
+	}
+	double rate;
+	if (sc_parse_double(s, (size_t)(slash - s), &rate) != (size_t)(slash - s) || !(rate > 0)) return -1;
+	long burst = 1;
+	if (slash[2] == ',') {
+		char *end;
+		burst = strtol(slash + 3, &end, 10);
+		if (end == slash + 3 || *end != '\0' || burst < 1 || burst > 1000000) return -1;
+	} else if (slash[2] != '\0') {
+		return -1;
+	}
+	o->ctrl_rate = rate;
+	o->ctrl_burst = (int)burst;
+	return 0;
+}
+
+// Parse -S "1ms[,busy=50]"
+static int parse_spin(const char *s, struct sc_options *o) {
+	char buf[64];
+	if (strlen(s) >= sizeof(buf)) return -1;
+	strcpy(buf, s);
+	char *busy = strchr(buf, ',');
+	if (busy) *busy++ = '\0';
+	if (parse_duration(buf, &o->spin_idle_ns) < 0) return -1;
+	o->busy_poll_us = 50;
+	if (busy) {
+		char *end;
+		if (strncmp(busy, "busy=", 5) != 0) return -1;
+		long us = strtol(busy + 5, &end, 10);
+		if (end == busy + 5 || *end != '\0' || us < 0 || us > 1000000) return -1;
+		o->busy_poll_us = (int)us;
+	}
+	return 0;
+}
+
+// Parse -M "1s[,stderr][,shm=/sigclient]"
+static int parse_metrics(const char *s, struct sc_options *o) {
+	char buf[128];
+	if (strlen(s) >= sizeof(buf)) return -1;
+	strcpy(buf, s);
+	char *save = NULL, *tok = strtok_r(buf, ",", &save);
+	if (!tok || parse_duration(tok, &o->metrics_ns) < 0) return -1;
+	o->metrics_stderr = 0;
+	free(o->metrics_shm);
+	o->metrics_shm = NULL;
+	while ((tok = strtok_r(NULL, ",", &save))) {
+		if (strcmp(tok, "stderr") == 0) {
+			o->metrics_stderr = 1;
+		} else if (strncmp(tok, "shm=", 4) == 0 && tok[4]) {
+			// shm_open names start with '/'
+			free(o->metrics_shm);
+			o->metrics_shm = malloc(strlen(tok + 4) + 2);
+			if (!o->metrics_shm) return -1;
+			sprintf(o->metrics_shm, "%s%s", tok[4] == '/' ? "" : "/", tok + 4);
+		} else {
+			return -1;
+		}
+	}
+	if (!o->metrics_shm) o->metrics_stderr = 1;
+	return 0;
+}
+
+// Parse -P "shm=sigclient[,slots=1024][,unix=/tmp/sigclient.sock]"
+static int parse_publish(const char *s, struct sc_options *o) {
+	char buf[256];
+	if (strlen(s) >= sizeof(buf)) return -1;
+	strcpy(buf, s);
+	for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		if (strncmp(tok, "shm=", 4) == 0 && tok[4]) {
+			free(o->feed_shm);
+			o->feed_shm = malloc(strlen(tok + 4) + 2);
+			if (!o->feed_shm) return -1;
+			sprintf(o->feed_shm, "%s%s", tok[4] == '/' ? "" : "/", tok + 4);
+		} else if (strncmp(tok, "slots=", 6) == 0) {
+			char *end;
+			long v = strtol(tok + 6, &end, 10);
+			if (end == tok + 6 || *end != '\0' || v < 2 || v > (1L << 20) || (v & (v - 1))) return -1;
+			o->feed_slots = (unsigned)v;
+		} else if (strncmp(tok, "unix=", 5) == 0 && tok[5]) {
+			free(o->feed_unix);
+			o->feed_unix = strdup(tok + 5);
+			if (!o->feed_unix) return -1;
+		} else {
+			return -1;
+		}
+	}
+	if (!o->feed_shm && !o->feed_unix) return -1;
+	return 0;
+}
+
+// Parse -F "1s[,n=256]"
+static int parse_analysis(const char *s, struct sc_options *o) {
+	char buf[64];
+	if (strlen(s) >= sizeof(buf)) return -1;
+	strcpy(buf, s);
+	char *save = NULL, *tok = strtok_r(buf, ",", &save);
+	if (!tok || parse_duration(tok, &o->analysis_ns) < 0) return -1;
+	o->analysis_len = 0;
+	while ((tok = strtok_r(NULL, ",", &save))) {
+		if (strncmp(tok, "n=", 2) != 0) return -1;
+		char *end;
+		long v = strtol(tok + 2, &end, 10);
+		if (end == tok + 2 || *end != '\0' || v < SC_ANALYSIS_MIN || v > (1L << 16) || (v & (v - 1))) return -1;
+		o->analysis_len = (unsigned)v;
+	}
+	return 0;
+}
+
+// Parse -r "size=64M,time=10min"
+static int parse_rotate(const char *s, struct sc_options *o) {
+	char buf[64];
+	if (strlen(s) >= sizeof(buf)) return -1;
+	strcpy(buf, s);
+	for (char *save = NULL, *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+		if (strncmp(tok, "time=", 5) == 0) {
+			if (parse_duration(tok + 5, &o->rotate_ns) < 0) return -1;
+		} else if (strncmp(tok, "size=", 5) == 0) {
+			char *end;
+			double v;
+			size_t n = sc_parse_double(tok + 5, strlen(tok + 5), &v);
+			end = tok + 5 + n;
+			if (n == 0 || !(v > 0)) return -1;
+			if (*end == 'k' || *end == 'K') v *= 1 << 10, end++;
+			else if (*end == 'M') v *= 1 << 20, end++;
+			else if (*end == 'G') v *= 1 << 30, end++;
+			if (*end != '\0' || v > (double)(1LL << 40)) return -1;
+			o->rotate_bytes = (long long)v;
+		} else {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+// Parse -A "kernel|loop[,interp]"
+static int parse_arrival(const char *s, struct sc_options *o) {
+	const char *comma = strchr(s, ',');
+	size_t n = comma ? (size_t)(comma - s) : strlen(s);
+	if (n == 6 && strncmp(s, "kernel", n) == 0) o->arrival = SC_ARRIVAL_KERNEL;
+	else if (n == 4 && strncmp(s, "loop", n) == 0) o->arrival = SC_ARRIVAL_LOOP;
+	else return -1;
+	o->interp = 0;
+	if (comma) {
+		if (strcmp(comma + 1, "interp") != 0) return -1;
+		o->interp = 1;
+	}
+	return 0;
+}
+
+// Parse -T "policy[,slots]"
+static int parse_threaded(const char *s, struct sc_options *o) {
+	static const struct { const char *name; enum sc_ring_policy policy; } policies[] = {
+		{ "block", SC_RING_BLOCK },
+		{ "drop-oldest", SC_RING_DROP_OLDEST },
+		{ "drop-newest", SC_RING_DROP_NEWEST },
+	};
+	const char *comma = strchr(s, ',');
+	size_t n = comma ? (size_t)(comma - s) : strlen(s);
+	int found = 0;
+	for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); ++i) {
+		if (strlen(policies[i].name) == n && strncmp(s, policies[i].name, n) == 0) {
+			o->ring_policy = policies[i].policy;
+			found = 1;
+		}
+	}
+	if (!found) return -1;
+	if (comma) {
+		char *end;
+		long v = strtol(comma + 1, &end, 10);
+		if (end == comma + 1 || *end != '\0' || v < 2 || v > (1L << 20)) return -1;
+		o->ring_slots = (unsigned)v;
+	}
+	o->threaded = 1;
+	return 0;
+}
+
+// Parse the -f flush policy
+static int parse_flush(const char *s, struct sc_options *o) {
+	const char *eq = strchr(s, '=');
+	if (!eq) {
+		if (strcmp(s, "tick") != 0) return -1;
+		o->flush = SC_FLUSH_TICK;
+		return 0;
+	}
+	size_t n = eq - s;
+	if (n == 8 && strncmp(s, "deadline", n) == 0) {
+		o->flush = SC_FLUSH_DEADLINE;
+		return parse_duration(eq + 1, &o->flush_arg);
+	}
+	char *end;
+	long long v = strtoll(eq + 1, &end, 10);
+	if (end == eq + 1 || *end != '\0' || v <= 0 || v > (1LL << 30)) return -1;
+	o->flush_arg = v;
+	if (n == 5 && strncmp(s, "ticks", n) == 0) o->flush = SC_FLUSH_TICKS;
+	else if (n == 4 && strncmp(s, "size", n) == 0) o->flush = SC_FLUSH_SIZE;
+	else return -1;
+	return 0;
+}
+
+// Load stream specs from a file. Returns 0, or -1 if it cannot be read or
+// contains a bad spec (reported on stderr with its line number).
+int sc_options_load(struct sc_options *o, const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	char line[256];
+	int lineno = 0, rc = 0;
+	while (fgets(line, sizeof(line), f)) {
+		lineno++;
+		char *hash = strchr(line, '#');
+		if (hash) *hash = '\0';
+		sc_trim(line);
+		if (line[0] == '\0') continue;
+		if (sc_options_add_stream(o, line) < 0) {
+			fprintf(stderr, "%s:%d: bad stream spec '%s'\n", path, lineno, line);
+			rc = -1;
+			break;
+		}
+	}
+	fclose(f);
+	return rc;
+}
+
+// Returns 0 on success, -1 (after printing usage) on bad arguments
+int sc_options_parse(struct sc_options *o, int argc, char **argv) {
+	int opt;
+	while ((opt = getopt(argc, argv, "a:A:b:c:C:Ef:F:j:lL:M:no:O:P:r:R:s:S:T:uw:h")) != -1) {
+		switch (opt) {
+		case 'a':
+			if (sc_stats_parse_fields(optarg, strlen(optarg), &o->agg) < 0) {
+				fprintf(stderr, "%s: bad aggregate fields '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'A':
+			if (parse_arrival(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad arrival setting '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'b':
+			if (sc_ev_backend_parse(optarg, &o->backend) < 0) {
+				fprintf(stderr, "%s: unknown backend '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'c':
+			if (sc_options_load(o, optarg) < 0) return -1;
+			break;
+		case 'C':
+			free(o->capture_dir);
+			o->capture_dir = strdup(optarg);
+			if (!o->capture_dir) return -1;
+			o->format = SC_OUT_BIN;
+			break;
+		case 'L':
+			if (parse_limit(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad control limit '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'M':
+			if (parse_metrics(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad metrics setting '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'S':
+			if (parse_spin(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad spin setting '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'R':
+			free(o->rules_path);
+			o->rules_path = strdup(optarg);
+			if (!o->rules_path) return -1;
+			break;
+		case 'r':
+			if (parse_rotate(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad rotation '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'T':
+			if (parse_threaded(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad thread option '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'f':
+			if (parse_flush(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad flush policy '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'E':
+			o->on_arrival = 1;
+			break;
+		case 'j': {
+			char *end;
+			long v = strtol(optarg, &end, 10);
+			if (end == optarg || *end != '\0' || v < 1 || v > SC_MAX_SHARDS) {
+				fprintf(stderr, "%s: bad shard count '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			o->shards = (int)v;
+			break;
+		}
+		case 'l':
+			o->lateness = 1;
+			break;
+		case 'n':
+			o->numeric = 1;
+			break;
+		case 'O':
+			if (sc_options_parse_sockopts(optarg, &o->sock) < 0) {
+				fprintf(stderr, "%s: bad socket options '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'P':
+			if (parse_publish(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad publish setting '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'F':
+			if (parse_analysis(optarg, o) < 0) {
+				fprintf(stderr, "%s: bad analysis setting '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'o':
+			if (strcmp(optarg, "json") == 0) {
+				o->format = SC_OUT_JSON;
+			} else if (strcmp(optarg, "bin") == 0) {
+				o->format = SC_OUT_BIN;
+			} else {
+				fprintf(stderr, "%s: unknown output format '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 's':
+			if (sc_options_add_stream(o, optarg) < 0) {
+				fprintf(stderr, "%s: bad stream spec '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		case 'u':
+			o->timestamp_us = 1;
+			break;
+		case 'w':
+			if (parse_duration(optarg, &o->window_ns) < 0 || o->window_ns < SC_MIN_WINDOW_NS ||
+			    o->window_ns > 3600 * 1000 * SC_NS_PER_MS) {
+				fprintf(stderr, "%s: bad window '%s'\n", argv[0], optarg);
+				usage(argv[0]);
+				return -1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if (optind < argc) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (o->nstreams == 0) {
+		int ports[] = SC_DEFAULT_PORTS;
+		for (size_t i = 0; i < sizeof(ports) / sizeof(ports[0]); ++i) {
+			char spec[16];
+			snprintf(spec, sizeof(spec), "%d", ports[i]);
+			sc_options_add_stream(o, spec);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,434 @@
+// output.c
+// Per-tick output encoders. JSON lines: the constant parts (the padded
+// key of every stream) are rendered once at start-up; each tick only
+// copies them and appends the values with hand-rolled integer and
+// string appends into one preallocated buffer. Binary records (see
+// binfmt.h) are fixed-size and need no formatting at all. The buffer is
+// written with a single write() per batch, when the flush policy says
+// so, instead of printf + fflush per line.
+//
+// With -T the ingest loop never writes: each record is encoded straight
+// into a slot of an SPSC ring (ring.c) and a writer thread drains the
+// ring, batching whatever has queued into one write(). A slow stdout
+// consumer then only fills the ring instead of delaying the event loop;
+// what happens when it is full is the ring's overflow policy.
+//
+// With -P every record is also handed to the feed (feed.c) as soon as it
+// is encoded, whatever the flush policy or sink.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "sigclient.h"
+#include "binfmt.h"
+
+#define OUT_MIN_CAP 65536
+#define NUM_MAX 32  // longest %.17g double
+
+static inline char *put(char *p, const char *s, size_t n) {
+	memcpy(p, s, n);
+	return p + n;
+}
+
+#define PUT_LIT(p, lit) put(p, lit, sizeof(lit) - 1)
+
+static char *put_i64(char *p, long long v) {
+	char tmp[24];
+	int n = 0;
+	unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+	do {
+		tmp[n++] = (char)('0' + u % 10);
+		u /= 10;
+	} while (u);
+	if (v < 0) *p++ = '-';
+	while (n) *p++ = tmp[--n];
+	return p;
+}
+
+// JSON number, null if absent
+static char *put_number(char *p, double v) {
+	if (!isfinite(v)) return PUT_LIT(p, "null");
+	return p + sc_format_double(p, NUM_MAX, v);
+}
+
+// {"count": 3, "min": -1.2, ...} with the stream's selected fields
+static char *put_stats(char *p, const struct sc_stats *st, unsigned agg) {
+	*p++ = '{';
+	int first = 1;
+	for (int f = 0; f < SC_AGG_NFIELDS; ++f) {
+		if (!(agg & (1u << f))) continue;
+		const char *name = sc_stats_field_name(f);
+		if (!first) p = PUT_LIT(p, ", ");
+		first = 0;
+		*p++ = '"';
+		p = put(p, name, strlen(name));
+		p = PUT_LIT(p, "\": ");
+		p = put_number(p, sc_stats_field(st, 1u << f));
+	}
+	*p++ = '}';
+	return p;
+}
+
+// Output columns of a binary record: one per plain stream, one per
+// selected field of an aggregated stream
+static int bin_columns(const struct sc_client *c) {
+	int n = 0;
+	for (int i = 0; i < c->nconns; ++i)
+		n += c->streams[i].agg ? __builtin_popcount(c->streams[i].agg) : 1;
+	return n;
+}
+
+// Schema header at the start of the output
+static void put_bin_header(struct sc_out *o, const struct sc_client *c) {
+	struct sc_bin_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, SC_BIN_MAGIC, sizeof(h.magic));
+	h.version = SC_BIN_VERSION;
+	h.ncols = (uint16_t)o->ncols;
+	h.header_size = (uint32_t)(sizeof(h) + o->ncols * sizeof(struct sc_bin_column));
+	h.record_size = (uint32_t)SC_BIN_RECORD_SIZE(o->ncols);
+	h.window_ns = c->window_ns;
+	memcpy(o->buf, &h, sizeof(h));
+	o->len = sizeof(h);
+
+	for (int i = 0; i < c->nconns; ++i) {
+		const struct sc_stream *s = &c->streams[i];
+		for (int f = -1; f < SC_AGG_NFIELDS; ++f) {
+			if (f < 0 ? s->agg != 0 : !(s->agg & (1u << f))) continue;
+			struct sc_bin_column col;
+			memset(&col, 0, sizeof(col));
+			if (f < 0) snprintf(col.name, sizeof(col.name), "%s", s->name);
+			else snprintf(col.name, sizeof(col.name), "%s.%s", s->name, sc_stats_field_name(f));
+			memcpy(o->buf + o->len, &col, sizeof(col));
+			o->len += sizeof(col);
+		}
+	}
+}
+
+static int bin_init(struct sc_out *o, const struct sc_client *c) {
+	o->ncols = bin_columns(c);
+	if (o->ncols > UINT16_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	o->max_line = SC_BIN_RECORD_SIZE(o->ncols);
+	size_t header = sizeof(struct sc_bin_header) + o->ncols * sizeof(struct sc_bin_column);
+	o->cap = OUT_MIN_CAP;
+	if (o->cap < header + 2 * o->max_line) o->cap = header + 2 * o->max_line;
+	if (o->policy == SC_FLUSH_SIZE && o->cap < (size_t)o->flush_arg + o->max_line)
+		o->cap = (size_t)o->flush_arg + o->max_line;
+	o->buf = sc_arena_alloc(c->arena, o->cap, 64);
+	if (!o->buf) return -1;
+	put_bin_header(o, c);
+	return 0;
+}
+
+static int out_setup(struct sc_out *o, const struct sc_client *c, const struct sc_options *opts) {
+	memset(o, 0, sizeof(*o));
+	o->fd = STDOUT_FILENO;
+	o->format = opts->format;
+	o->policy = opts->flush;
+	o->flush_arg = opts->flush_arg;
+	if (o->format == SC_OUT_BIN) {
+		if (bin_init(o, c) < 0) {
+			sc_out_free(o);
+			return -1;
+		}
+		if (opts->capture_dir) {
+			// every segment gets the header; nothing goes to stdout
+			if (sc_capture_open(&o->capture, opts->capture_dir, o->buf, o->len, o->max_line,
+					opts->rotate_bytes, opts->rotate_ns) < 0) {
+				sc_out_free(o);
+				return -1;
+			}
+			o->capturing = 1;
+			o->len = 0;
+		}
+		return 0;
+	}
+
+	// pad after the quoted key (not inside it) so the colons line up
+	size_t max_key = 0, total = 0;
+	for (int i = 0; i < c->nconns; ++i) {
+		size_t k = strlen(c->streams[i].name);
+		if (k > max_key) max_key = k;
+	}
+	o->tmpl_off = sc_arena_array(c->arena, c->nconns + 1, sizeof(*o->tmpl_off));
+	o->tmpl = sc_arena_alloc(c->arena, (size_t)c->nconns * (max_key + 8) + 1, 1);
+	if (!o->tmpl_off || !o->tmpl) {
+		sc_out_free(o);
+		return -1;
+	}
+	size_t line = sizeof("{\"timestamp_us\": , \"late_us\": }\n") + 2 * 24;
+	for (int i = 0; i < c->nconns; ++i) {
+		const char *name = c->streams[i].name;
+		o->tmpl_off[i] = (unsigned)total;
+		total += sprintf(o->tmpl + total, ", \"%s\"%*s: ", name, (int)(max_key - strlen(name)), "");
+		// worst case value: a full token in quotes, or every stats field
+		size_t v = SC_TOKEN_MAX + 2;
+		if (c->streams[i].agg) v = 2 + SC_AGG_NFIELDS * (sizeof(", \"count\": ") + NUM_MAX);
+		line += (total - o->tmpl_off[i]) + v;
+	}
+	o->tmpl_off[c->nconns] = (unsigned)total;
+	if (c->analysis && c->analysis->line_max > line) line = c->analysis->line_max;
+	o->max_line = line;
+
+	o->cap = OUT_MIN_CAP;
+	if (o->cap < 2 * line) o->cap = 2 * line;
+	if (o->policy == SC_FLUSH_SIZE && o->cap < (size_t)o->flush_arg + line) o->cap = (size_t)o->flush_arg + line;
+	o->buf = sc_arena_alloc(c->arena, o->cap, 64);
+	if (!o->buf) {
+		sc_out_free(o);
+		return -1;
+	}
+	return 0;
+}
+
+static int write_all(int fd, const char *buf, size_t len) {
+	size_t off = 0;
+	while (off < len) {
+		ssize_t w = write(fd, buf + off, len - off);
+		if (w < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		off += (size_t)w;
+	}
+	return 0;
+}
+
+static void *writer_main(void *arg) {
+	struct sc_out *o = arg;
+	for (;;) {
+		// read the flag first: everything published before it is set
+		// is then guaranteed to be drained below
+		int closing = atomic_load(&o->closing);
+		size_t n = sc_ring_drain(&o->ring, o->buf, o->cap);
+		if (n) {
+			write_all(o->fd, o->buf, n);
+			continue;
+		}
+		if (closing) break;
+		while (sem_wait(&o->ring.items) < 0 && errno == EINTR) {}
+	}
+	return NULL;
+}
+
+static int start_writer(struct sc_out *o, struct sc_arena *a, const struct sc_options *opts) {
+	unsigned slots = opts->ring_slots ? opts->ring_slots : SC_RING_SLOTS;
+	if (sc_ring_init(&o->ring, a, slots, o->max_line, opts->ring_policy) < 0) return -1;
+	atomic_init(&o->closing, 0);
+	int err = pthread_create(&o->writer, NULL, writer_main, o);
+	if (err) {
+		sc_ring_free(&o->ring);
+		errno = err;
+		return -1;
+	}
+	o->threaded = 1;
+	return 0;
+}
+
+// Drain the ring, join the writer and report overflow counters
+static void stop_writer(struct sc_out *o) {
+	atomic_store(&o->closing, 1);
+	sem_post(&o->ring.items);
+	pthread_join(o->writer, NULL);
+	const struct sc_ring *r = &o->ring;
+	if (r->dropped_oldest || r->dropped_newest || r->blocked)
+		fprintf(stderr, "sigclient: writer ring: %lld dropped oldest, %lld dropped newest, "
+			"%lld blocked, high water %llu/%u\n",
+			r->dropped_oldest, r->dropped_newest, r->blocked, r->high_water, r->mask + 1);
+	sc_ring_free(&o->ring);
+	o->threaded = 0;
+}
+
+int sc_out_init(struct sc_out *o, const struct sc_client *c, const struct sc_options *opts) {
+	if (out_setup(o, c, opts) < 0) return -1;
+	if (opts->feed_shm || opts->feed_unix) {
+		size_t header = o->format == SC_OUT_BIN ? sizeof(struct sc_bin_header) + o->ncols * sizeof(struct sc_bin_column) : 0;
+		o->feeding = 1;
+		if (sc_feed_open(&o->feed, c->arena, opts, o->format, c->window_ns, o->buf, header, o->max_line) < 0) {
+			int err = errno;
+			sc_out_free(o);
+			errno = err;
+			return -1;
+		}
+	}
+	if (opts->threaded && !o->capturing) {
+		// the schema header must come first, before the writer starts
+		if (sc_out_flush(o) < 0 || start_writer(o, c->arena, opts) < 0) {
+			fprintf(stderr, "sigclient: writer thread unavailable (%s), writing inline\n", strerror(errno));
+		}
+	}
+	return 0;
+}
+
+void sc_out_free(struct sc_out *o) {
+	if (o->threaded) stop_writer(o);
+	if (o->capturing) sc_capture_close(&o->capture);
+	if (o->feeding) sc_feed_close(&o->feed);
+	memset(o, 0, sizeof(*o));  // buffers are the arena's
+}
+
+// Write everything buffered. Returns 0, or -1 (errno set) if the output
+// failed; the buffer is discarded either way. With a writer thread the
+// buffer belongs to it and this does nothing; sc_out_free drains the ring.
+int sc_out_flush(struct sc_out *o) {
+	if (o->threaded) return 0;
+	int rc = write_all(o->fd, o->buf, o->len);
+	o->len = 0;
+	o->pending = 0;
+	return rc;
+}
+
+static int flush_due(const struct sc_out *o, long long now_ns) {
+	switch (o->policy) {
+	case SC_FLUSH_TICK: return 1;
+	case SC_FLUSH_TICKS: return o->pending >= o->flush_arg;
+	case SC_FLUSH_SIZE: return o->len >= (size_t)o->flush_arg;
+	case SC_FLUSH_DEADLINE: return now_ns - o->first_ns >= o->flush_arg;
+	}
+	return 1;
+}
+
+static inline void put_column(char *bits, char *vals, int col, double v) {
+	if (!isnan(v)) bits[col >> 3] |= (char)(1 << (col & 7));
+	memcpy(vals + 8 * (size_t)col, &v, sizeof(v));
+}
+
+static char *put_bin_record(const struct sc_client *c, char *p, long long ts_ns) {
+	const struct sc_out *o = &c->out;
+	struct sc_bin_record r;
+	r.sync = SC_BIN_SYNC;
+	r.seq = (uint32_t)(c->sched.ticks - 1 + c->sched.skipped);
+	r.ts_ns = ts_ns;
+	memcpy(p, &r, sizeof(r));
+	char *bits = p + sizeof(r);
+	char *vals = bits + SC_BIN_BITMAP_SIZE(o->ncols);
+	memset(bits, 0, SC_BIN_BITMAP_SIZE(o->ncols));
+
+	int col = 0;
+	for (int i = 0; i < c->nconns; ++i) {
+		unsigned agg = c->streams[i].agg;
+		if (!agg) {
+			put_column(bits, vals, col++, sc_conn_number(&c->conns[i]));
+			continue;
+		}
+		for (int f = 0; f < SC_AGG_NFIELDS; ++f)
+			if (agg & (1u << f)) put_column(bits, vals, col++, sc_stats_field(c->conns[i].stats, 1u << f));
+	}
+	return vals + 8 * (size_t)o->ncols;
+}
+
+// JSON line: the latest value per stream as a quoted string ("--" if
+// none), or a number (null if none) in numeric mode; aggregated streams
+// get an object with their window statistics
+static char *put_json_line(const struct sc_client *c, char *p, long long ts_ns) {
+	const struct sc_out *o = &c->out;
+	if (c->timestamp_us) {
+		p = PUT_LIT(p, "{\"timestamp_us\": ");
+		p = put_i64(p, ts_ns / 1000);
+	} else {
+		p = PUT_LIT(p, "{\"timestamp\": ");
+		p = put_i64(p, ts_ns / SC_NS_PER_MS);
+	}
+	if (c->lateness) {
+		p = PUT_LIT(p, ", \"late_us\": ");
+		p = put_i64(p, c->sched.late_last_ns / 1000);
+	}
+	for (int i = 0; i < c->nconns; ++i) {
+		const struct sc_conn *conn = &c->conns[i];
+		p = put(p, o->tmpl + o->tmpl_off[i], o->tmpl_off[i + 1] - o->tmpl_off[i]);
+		if (c->streams[i].agg) {
+			p = put_stats(p, c->conns[i].stats, c->streams[i].agg);
+		} else if (c->numeric) {
+			p = put_number(p, sc_conn_number(conn));
+		} else if (conn->have) {
+			*p++ = '"';
+			p = put(p, conn->inbuf + conn->lat_off, conn->lat_len);
+			*p++ = '"';
+		} else {
+			p = PUT_LIT(p, "\"--\"");
+		}
+	}
+	return PUT_LIT(p, "}\n");
+}
+
+// -F: queue the window for the analysis thread and write the analysis
+// lines it has ready, like window lines
+static void put_analysis(struct sc_client *c, long long ts_ns) {
+	struct sc_out *o = &c->out;
+	struct sc_analysis *a = c->analysis;
+	sc_analysis_push(c, ts_ns);
+	size_t n;
+	while ((n = sc_analysis_take(a)) > 0) {
+		if (o->threaded) {
+			char *slot = sc_ring_claim(&o->ring);
+			if (!slot) continue;
+			memcpy(slot, a->take, n);
+			sc_ring_publish(&o->ring, n);
+		} else {
+			if (o->cap - o->len < n) sc_out_flush(o);
+			memcpy(o->buf + o->len, a->take, n);
+			o->len += n;
+		}
+		if (o->feeding) sc_feed_publish(&o->feed, a->take, n);
+	}
+}
+
+// Encode the window's record in the selected format. It is buffered and
+// written according to the flush policy.
+static void time_phase(struct sc_client *c, int kind, long long t0) {
+	if (c->metrics) sc_hist_add(&c->metrics->loop.hist[kind], sc_mono_ns() - t0);
+}
+
+void sc_client_output(struct sc_client *c, long long ts_ns) {
+	struct sc_out *o = &c->out;
+	long long t0 = c->metrics ? sc_mono_ns() : 0;
+	if (o->capturing) {
+		char *rec = sc_capture_reserve(&o->capture, ts_ns);
+		if (rec) {
+			put_bin_record(c, rec, ts_ns);
+			sc_capture_commit(&o->capture, ts_ns);
+			if (o->feeding) sc_feed_publish(&o->feed, rec, o->max_line);
+		}
+		time_phase(c, SC_HIST_FORMAT, t0);
+		return;
+	}
+	if (o->threaded) {
+		char *slot = sc_ring_claim(&o->ring);
+		if (!slot) return;
+		char *end = o->format == SC_OUT_BIN ? put_bin_record(c, slot, ts_ns) : put_json_line(c, slot, ts_ns);
+		if (o->feeding) sc_feed_publish(&o->feed, slot, end - slot);
+		sc_ring_publish(&o->ring, end - slot);
+		if (c->analysis) put_analysis(c, ts_ns);
+		time_phase(c, SC_HIST_FORMAT, t0);
+		return;
+	}
+	if (o->cap - o->len < o->max_line) sc_out_flush(o);
+
+	char *rec = o->buf + o->len, *p;
+	if (o->format == SC_OUT_BIN) p = put_bin_record(c, rec, ts_ns);
+	else p = put_json_line(c, rec, ts_ns);
+	o->len = p - o->buf;
+	if (o->feeding) sc_feed_publish(&o->feed, rec, p - rec);
+	if (c->analysis) put_analysis(c, ts_ns);
+
+	long long now_ns = sc_mono_ns();
+	if (c->metrics) sc_hist_add(&c->metrics->loop.hist[SC_HIST_FORMAT], now_ns - t0);
+	if (o->pending++ == 0) o->first_ns = now_ns;
+	if (flush_due(o, now_ns)) {
+		sc_out_flush(o);
+		time_phase(c, SC_HIST_FLUSH, now_ns);
+	}
+}
+
+// Write out buffered lines now (e.g. before exiting)
+int sc_client_flush(struct sc_client *c) {
+	return sc_out_flush(&c->out);
+}
@@ -0,0 +1,117 @@
+// ring.c
+// Single-producer/single-consumer ring of fixed-size record slots. The
+// producer (ingest loop) owns head, the consumer (writer thread) owns
+// tail, so the fast path on either side is one atomic load and one
+// release store; no locks. The only shared write is in drop-oldest mode,
+// where a producer facing a full ring advances tail itself with a CAS.
+// The consumer therefore copies records out first and commits them with
+// a CAS on tail: if that fails, the producer stole (and may be
+// overwriting) some of them, so the copy is discarded and retried.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sigclient.h"
+
+#define SLOT_HDR 8              // uint32 length, padded
+#define BLOCK_SLEEP_NS 50000    // producer back-off while the ring is full
+
+static char *slot(const struct sc_ring *r, unsigned long long i) {
+	return r->slots + (size_t)(i & r->mask) * r->stride;
+}
+
+int sc_ring_init(struct sc_ring *r, struct sc_arena *a, unsigned nslots, size_t slot_size, enum sc_ring_policy policy) {
+	memset(r, 0, sizeof(*r));
+	unsigned n = 1;
+	while (n < nslots) n <<= 1;
+	r->mask = n - 1;
+	r->slot_size = slot_size;
+	r->stride = (SLOT_HDR + slot_size + 63) & ~(size_t)63;
+	r->policy = policy;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	r->slots = sc_arena_alloc(a, (size_t)n * r->stride, 64);
+	if (!r->slots) return -1;
+	if (sem_init(&r->items, 0, 0) < 0) {
+		r->slots = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+void sc_ring_free(struct sc_ring *r) {
+	if (!r->slots) return;
+	sem_destroy(&r->items);
+	r->slots = NULL;
+}
+
+// Slot for the next record (slot_size bytes), applying the overflow
+// policy if the ring is full. NULL if the record is to be dropped.
+char *sc_ring_claim(struct sc_ring *r) {
+	unsigned long long h = atomic_load_explicit(&r->head, memory_order_relaxed);
+	unsigned long long t = atomic_load_explicit(&r->tail, memory_order_acquire);
+	if (h - t > r->mask) {
+		switch (r->policy) {
+		case SC_RING_DROP_NEWEST:
+			r->dropped_newest++;
+			return NULL;
+		case SC_RING_DROP_OLDEST:
+			// on failure the writer just consumed it, which frees a slot too
+			if (atomic_compare_exchange_strong_explicit(&r->tail, &t, t + 1,
+					memory_order_acq_rel, memory_order_acquire))
+				r->dropped_oldest++;
+			break;
+		case SC_RING_BLOCK:
+			r->blocked++;
+			do {
+				struct timespec ts = { 0, BLOCK_SLEEP_NS };
+				nanosleep(&ts, NULL);
+			} while (h - atomic_load_explicit(&r->tail, memory_order_acquire) > r->mask);
+			break;
+		}
+	}
+	return slot(r, h) + SLOT_HDR;
+}
+
+// Publish the claimed slot holding len bytes and wake the consumer
+void sc_ring_publish(struct sc_ring *r, size_t len) {
+	unsigned long long h = atomic_load_explicit(&r->head, memory_order_relaxed);
+	uint32_t l = (uint32_t)len;
+	memcpy(slot(r, h), &l, sizeof(l));
+	atomic_store_explicit(&r->head, h + 1, memory_order_release);
+	unsigned long long depth = h + 1 - atomic_load_explicit(&r->tail, memory_order_relaxed);
+	if (depth > r->high_water) r->high_water = depth;
+	sem_post(&r->items);
+}
+
+// Consumer: copy as many whole records as fit into dst[0..cap) and
+// release their slots. Returns the bytes copied, 0 if the ring is empty.
+size_t sc_ring_drain(struct sc_ring *r, char *dst, size_t cap) {
+	for (;;) {
+		unsigned long long t = atomic_load_explicit(&r->tail, memory_order_acquire);
+		unsigned long long h = atomic_load_explicit(&r->head, memory_order_acquire);
+		if (t == h) return 0;
+
+		size_t len = 0;
+		unsigned long long k = t;
+		int torn = 0;
+		for (; k != h; ++k) {
+			const char *s = slot(r, k);
+			uint32_t l;
+			memcpy(&l, s, sizeof(l));
+			if (l > r->slot_size) {
+				torn = 1;   // slot is being rewritten after a steal
+				break;
+			}
+			if (len + l > cap) break;
+			memcpy(dst + len, s + SLOT_HDR, l);
+			len += l;
+		}
+		if (!torn && atomic_compare_exchange_strong_explicit(&r->tail, &t, k,
+				memory_order_acq_rel, memory_order_acquire))
+			return len;
+		// the producer dropped records under us; start over from the new tail
+	}
+}
@@ -0,0 +1,184 @@
+// rules.c
+// Parser and compiler for the control rule table (see rules.h).
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "rules.h"
+
+static int add_target(struct sc_rules *rs, uint16_t obj, uint16_t prop) {
+	for (int i = 0; i < rs->ntargets; ++i)
+		if (rs->targets[i].obj == obj && rs->targets[i].prop == prop) return i;
+	struct sc_rule_target *t = realloc(rs->targets, (rs->ntargets + 1) * sizeof(*t));
+	if (!t) return -1;
+	rs->targets = t;
+	t[rs->ntargets].obj = obj;
+	t[rs->ntargets].prop = prop;
+	return rs->ntargets++;
+}
+
+static int parse_u16(const char *s, const char *end, uint16_t *out) {
+	if (s == end) return -1;
+	long v = 0;
+	for (; s < end; ++s) {
+		if (*s < '0' || *s > '9') return -1;
+		v = v * 10 + (*s - '0');
+		if (v > 65535) return -1;
+	}
+	*out = (uint16_t)v;
+	return 0;
+}
+
+// "obj:prop=value,..." appended to rs->actions; returns the count, -1 on error
+static int parse_actions(struct sc_rules *rs, char *s) {
+	int n = 0;
+	for (char *save = NULL, *a = strtok_r(s, ",", &save); a; a = strtok_r(NULL, ",", &save)) {
+		char *colon = strchr(a, ':'), *eq = strchr(a, '=');
+		uint16_t obj, prop, val;
+		if (!colon || !eq || eq < colon || parse_u16(a, colon, &obj) < 0 ||
+		    parse_u16(colon + 1, eq, &prop) < 0 || parse_u16(eq + 1, eq + strlen(eq), &val) < 0)
+			return -1;
+		int t = add_target(rs, obj, prop);
+		struct sc_rule_action *act = realloc(rs->actions, (rs->nactions + 1) * sizeof(*act));
+		if (t < 0 || !act) return -1;
+		rs->actions = act;
+		act[rs->nactions].target = t;
+		act[rs->nactions].value = val;
+		rs->nactions++;
+		n++;
+	}
+	return n;
+}
+
+static int parse_rule(struct sc_rules *rs, char *line, const struct sc_client *c) {
+	char *save = NULL;
+	char *src = strtok_r(line, " \t", &save);
+	char *op = strtok_r(NULL, " \t", &save);
+	char *thr = strtok_r(NULL, " \t", &save);
+	char *tok = strtok_r(NULL, " \t", &save);
+	if (!src || !op || !thr || !tok) return -1;
+
+	struct sc_rule r;
+	memset(&r, 0, sizeof(r));
+	r.state = SC_RULE_UNKNOWN;
+	r.src = sc_client_find(c, src);
+	if (r.src < 0) {
+		fprintf(stderr, "sigclient: rule source '%s' is not a configured stream\n", src);
+		return -1;
+	}
+	if (strcmp(op, ">=") == 0) r.sign = 1;
+	else if (strcmp(op, ">") == 0) r.sign = 1, r.strict = 1;
+	else if (strcmp(op, "<=") == 0) r.sign = -1;
+	else if (strcmp(op, "<") == 0) r.sign = -1, r.strict = 1;
+	else return -1;
+
+	double t, band = 0;
+	if (sc_parse_double(thr, strlen(thr), &t) != strlen(thr)) return -1;
+	if (strcmp(tok, "band") == 0) {
+		char *w = strtok_r(NULL, " \t", &save);
+		if (!w || sc_parse_double(w, strlen(w), &band) != strlen(w) || !(band >= 0)) return -1;
+		tok = strtok_r(NULL, " \t", &save);
+	}
+	// compared as sign * x against sign * threshold, so the band edges
+	// swap sides for < and <=
+	t *= r.sign;
+	r.thr[0] = t + band / 2;    // false: must clear the upper edge
+	r.thr[1] = t - band / 2;    // true: stays true down to the lower edge
+	r.thr[SC_RULE_UNKNOWN] = t;
+
+	if (!tok || strcmp(tok, "then") != 0) return -1;
+	char *then = strtok_r(NULL, " \t", &save);
+	if (!then) return -1;
+	r.first[1] = rs->nactions;
+	if ((r.count[1] = parse_actions(rs, then)) < 0) return -1;
+	tok = strtok_r(NULL, " \t", &save);
+	r.first[0] = rs->nactions;
+	if (tok) {
+		char *other = strtok_r(NULL, " \t", &save);
+		if (strcmp(tok, "else") != 0 || !other || strtok_r(NULL, " \t", &save)) return -1;
+		if ((r.count[0] = parse_actions(rs, other)) < 0) return -1;
+	}
+
+	struct sc_rule *rules = realloc(rs->rules, (rs->nrules + 1) * sizeof(*rules));
+	if (!rules) return -1;
+	rs->rules = rules;
+	rules[rs->nrules++] = r;
+	return 0;
+}
+
+// Group the rules by source stream (stable) and build the offset table
+static int compile(struct sc_rules *rs, const struct sc_client *c) {
+	for (int i = 1; i < rs->nrules; ++i) {
+		struct sc_rule r = rs->rules[i];
+		int j = i;
+		for (; j > 0 && rs->rules[j - 1].src > r.src; --j) rs->rules[j] = rs->rules[j - 1];
+		rs->rules[j] = r;
+	}
+	rs->nstreams = c->nconns;
+	rs->by_src = calloc(c->nconns + 1, sizeof(*rs->by_src));
+	if (!rs->by_src) return -1;
+	for (int i = 0; i < rs->nrules; ++i) rs->by_src[rs->rules[i].src + 1]++;
+	for (int i = 0; i < c->nconns; ++i) rs->by_src[i + 1] += rs->by_src[i];
+	return 0;
+}
+
+int sc_rules_parse(struct sc_rules *rs, const char *text, const char *name, const struct sc_client *c) {
+	memset(rs, 0, sizeof(*rs));
+	char *copy = strdup(text);
+	if (!copy) return -1;
+	int lineno = 0, rc = 0;
+	for (char *line = copy, *next; line; line = next) {
+		next = strchr(line, '\n');
+		if (next) *next++ = '\0';
+		lineno++;
+		char *hash = strchr(line, '#');
+		if (hash) *hash = '\0';
+		sc_trim(line);
+		if (line[0] == '\0') continue;
+		char shown[256];
+		snprintf(shown, sizeof(shown), "%s", line);
+		if (parse_rule(rs, line, c) < 0) {
+			fprintf(stderr, "%s:%d: bad rule '%s'\n", name, lineno, shown);
+			rc = -1;
+			break;
+		}
+	}
+	free(copy);
+	if (rc == 0) rc = compile(rs, c);
+	if (rc < 0) {
+		sc_rules_free(rs);
+		errno = EINVAL;
+	}
+	return rc;
+}
+
+int sc_rules_load(struct sc_rules *rs, const char *path, const struct sc_client *c) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+	char *text = NULL;
+	size_t len = 0;
+	FILE *m = open_memstream(&text, &len);
+	char buf[4096];
+	size_t n;
+	while (m && (n = fread(buf, 1, sizeof(buf), f)) > 0) fwrite(buf, 1, n, m);
+	fclose(f);
+	if (!m) return -1;
+	fclose(m);
+	int rc = sc_rules_parse(rs, text, path, c);
+	free(text);
+	return rc;
+}
+
+void sc_rules_free(struct sc_rules *rs) {
+	free(rs->rules);
+	free(rs->actions);
+	free(rs->targets);
+	free(rs->by_src);
+	memset(rs, 0, sizeof(*rs));
+}
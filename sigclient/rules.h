@@ -0,0 +1,77 @@
+// rules.h
+// Declarative threshold rules for control logic (client2 -R). One rule
+// per line:
+//
+//   <stream> <op> <threshold> [band <width>] then <actions> [else <actions>]
+//
+//   op       >=  >  <=  <
+//   band     hysteresis: the rule turns true beyond threshold + width/2
+//            and false again only beyond threshold - width/2 (mirrored
+//            for < and <=), so noise inside the band sends nothing
+//   actions  comma-separated obj:prop=value writes, all 16-bit unsigned
+//
+// e.g. "out3 >= 3.0 band 0.2 then 1:255=1000,1:170=8000 else 1:255=2000,1:170=4000"
+//
+// Rules are compiled into flat arrays: rules grouped by source stream,
+// the actions of each rule state stored contiguously, and the distinct
+// obj:prop pairs numbered as targets. Evaluating a sample is a table
+// lookup and one comparison per rule of that stream.
+
+#ifndef SIGCLIENT_RULES_H
+#define SIGCLIENT_RULES_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "sigclient.h"
+
+#define SC_RULE_UNKNOWN 2   // state before the first sample
+
+struct sc_rule_target {
+	uint16_t obj, prop;
+};
+
+struct sc_rule_action {
+	int target;         // index into sc_rules.targets
+	uint16_t value;
+};
+
+struct sc_rule {
+	int src;            // stream index
+	int state;          // 0 false, 1 true, SC_RULE_UNKNOWN
+	int strict;         // > / < rather than >= / <=
+	double sign;        // -1 for < and <=, so every rule compares "above"
+	double thr[3];      // threshold per current state (hysteresis edges, middle)
+	int first[2];       // actions of state 0/1: actions[first, first + count)
+	int count[2];
+};
+
+struct sc_rules {
+	struct sc_rule *rules;          // sorted by src
+	int nrules;
+	struct sc_rule_action *actions;
+	int nactions;
+	struct sc_rule_target *targets;
+	int ntargets;
+	int *by_src;                    // nstreams + 1 offsets into rules
+	int nstreams;
+};
+
+// The rule table text (newline-separated lines, '#' comments), with
+// stream names resolved against c. Returns 0, or -1 after printing the
+// offending line (name is used in messages).
+int sc_rules_parse(struct sc_rules *rs, const char *text, const char *name, const struct sc_client *c);
+int sc_rules_load(struct sc_rules *rs, const char *path, const struct sc_client *c);
+void sc_rules_free(struct sc_rules *rs);
+
+// Feed x to rule r; returns 1 if its state changed (NaN changes nothing)
+static inline int sc_rule_eval(struct sc_rule *r, double x) {
+	if (isnan(x)) return 0;
+	double y = r->sign * x, t = r->thr[r->state];
+	int s = (y > t) | (!r->strict & (y == t));
+	int changed = s != r->state;
+	r->state = s;
+	return changed;
+}
+
+#endif
@@ -0,0 +1,218 @@
+// scan.c
+// Delimiter scanning kernels and run-time dispatch for scan.h.
+//
+// Each vector kernel compares a block against '\n' and '\r', turns the
+// result into a bitmask (one bit per byte, one nibble per byte on NEON)
+// and walks the set bits, so a block without delimiters costs a couple
+// of instructions. Tails shorter than a block use the scalar loop.
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SC_SCAN_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#define SC_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+static inline int is_delim(char ch) {
+	return ch == '\n' || ch == '\r';
+}
+
+// ---- scalar ----
+
+static size_t delims_scalar(const char *buf, size_t len, uint32_t *pos, size_t max) {
+	size_t n = 0;
+	for (size_t i = 0; i < len && n < max; ++i)
+		if (is_delim(buf[i])) pos[n++] = (uint32_t)i;
+	return n;
+}
+
+static long last_scalar(const char *buf, size_t len) {
+	for (size_t i = len; i > 0; --i)
+		if (is_delim(buf[i - 1])) return (long)(i - 1);
+	return -1;
+}
+
+// Append the positions of the set bits of mask (block at offset base)
+static inline size_t emit_mask(uint32_t mask, size_t base, uint32_t *pos, size_t n, size_t max) {
+	while (mask && n < max) {
+		pos[n++] = (uint32_t)(base + __builtin_ctz(mask));
+		mask &= mask - 1;
+	}
+	return n;
+}
+
+// ---- SSE2 ----
+
+#ifdef SC_SCAN_X86
+__attribute__((target("sse2")))
+static inline uint32_t mask16(const char *p) {
+	__m128i v = _mm_loadu_si128((const __m128i *)p);
+	__m128i nl = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+	__m128i cr = _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'));
+	return (uint32_t)_mm_movemask_epi8(_mm_or_si128(nl, cr));
+}
+
+__attribute__((target("sse2")))
+static size_t delims_sse2(const char *buf, size_t len, uint32_t *pos, size_t max) {
+	size_t i = 0, n = 0;
+	for (; i + 16 <= len && n < max; i += 16) n = emit_mask(mask16(buf + i), i, pos, n, max);
+	for (; i < len && n < max; ++i)
+		if (is_delim(buf[i])) pos[n++] = (uint32_t)i;
+	return n;
+}
+
+__attribute__((target("sse2")))
+static long last_sse2(const char *buf, size_t len) {
+	size_t i = len;
+	for (; i >= 16; i -= 16) {
+		uint32_t m = mask16(buf + i - 16);
+		if (m) return (long)(i - 16 + 31 - __builtin_clz(m));
+	}
+	return last_scalar(buf, i);
+}
+
+// ---- AVX2 ----
+
+__attribute__((target("avx2")))
+static inline uint32_t mask32(const char *p) {
+	__m256i v = _mm256_loadu_si256((const __m256i *)p);
+	__m256i nl = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+	__m256i cr = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'));
+	return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(nl, cr));
+}
+
+__attribute__((target("avx2")))
+static size_t delims_avx2(const char *buf, size_t len, uint32_t *pos, size_t max) {
+	size_t i = 0, n = 0;
+	for (; i + 32 <= len && n < max; i += 32) n = emit_mask(mask32(buf + i), i, pos, n, max);
+	for (; i < len && n < max; ++i)
+		if (is_delim(buf[i])) pos[n++] = (uint32_t)i;
+	return n;
+}
+
+__attribute__((target("avx2")))
+static long last_avx2(const char *buf, size_t len) {
+	size_t i = len;
+	for (; i >= 32; i -= 32) {
+		uint32_t m = mask32(buf + i - 32);
+		if (m) return (long)(i - 32 + 31 - __builtin_clz(m));
+	}
+	return last_scalar(buf, i);
+}
+
+static int have_sse2(void) { return __builtin_cpu_supports("sse2"); }
+static int have_avx2(void) { return __builtin_cpu_supports("avx2"); }
+#endif
+
+// ---- NEON ----
+
+#ifdef SC_SCAN_NEON
+// 64-bit mask with one nibble per input byte (shift-right-narrow trick)
+static inline uint64_t nibble_mask16(const char *p) {
+	uint8x16_t v = vld1q_u8((const uint8_t *)p);
+	uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')), vceqq_u8(v, vdupq_n_u8('\r')));
+	uint8x8_t nib = vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+	return vget_lane_u64(vreinterpret_u64_u8(nib), 0);
+}
+
+static size_t delims_neon(const char *buf, size_t len, uint32_t *pos, size_t max) {
+	size_t i = 0, n = 0;
+	for (; i + 16 <= len && n < max; i += 16) {
+		uint64_t bits = nibble_mask16(buf + i) & 0x1111111111111111ULL;
+		while (bits && n < max) {
+			pos[n++] = (uint32_t)(i + (__builtin_ctzll(bits) >> 2));
+			bits &= bits - 1;
+		}
+	}
+	for (; i < len && n < max; ++i)
+		if (is_delim(buf[i])) pos[n++] = (uint32_t)i;
+	return n;
+}
+
+static long last_neon(const char *buf, size_t len) {
+	size_t i = len;
+	for (; i >= 16; i -= 16) {
+		uint64_t bits = nibble_mask16(buf + i - 16);
+		if (bits) return (long)(i - 16 + ((63 - __builtin_clzll(bits)) >> 2));
+	}
+	return last_scalar(buf, i);
+}
+
+static int have_neon(void) { return 1; }   // mandatory on AArch64
+#endif
+
+// ---- dispatch ----
+
+struct scan_impl {
+	const char *name;
+	size_t (*delims)(const char *, size_t, uint32_t *, size_t);
+	long (*last)(const char *, size_t);
+	int (*supported)(void);
+};
+
+static int always(void) { return 1; }
+
+// best first
+static const struct scan_impl impls[] = {
+#ifdef SC_SCAN_X86
+	{ "avx2", delims_avx2, last_avx2, have_avx2 },
+	{ "sse2", delims_sse2, last_sse2, have_sse2 },
+#endif
+#ifdef SC_SCAN_NEON
+	{ "neon", delims_neon, last_neon, have_neon },
+#endif
+	{ "scalar", delims_scalar, last_scalar, always },
+};
+#define NIMPLS (sizeof(impls) / sizeof(impls[0]))
+
+static const struct scan_impl *active = &impls[NIMPLS - 1];
+
+size_t sc_scan_delims(const char *buf, size_t len, uint32_t *pos, size_t max) {
+	return active->delims(buf, len, pos, max);
+}
+
+long sc_scan_last_delim(const char *buf, size_t len) {
+	return active->last(buf, len);
+}
+
+int sc_scan_select(const char *name) {
+	for (size_t i = 0; i < NIMPLS; ++i) {
+		if (strcmp(impls[i].name, name) == 0 && impls[i].supported()) {
+			active = &impls[i];
+			return 0;
+		}
+	}
+	return -1;
+}
+
+void sc_scan_init(void) {
+	const char *env = getenv("SIGCLIENT_SCAN");
+	if (env && sc_scan_select(env) == 0) return;
+	for (size_t i = 0; i < NIMPLS; ++i) {
+		if (impls[i].supported()) {
+			active = &impls[i];
+			return;
+		}
+	}
+}
+
+const char *sc_scan_impl(void) {
+	return active->name;
+}
+
+const char *const *sc_scan_available(void) {
+	static const char *names[NIMPLS + 1];
+	size_t n = 0;
+	for (size_t i = 0; i < NIMPLS; ++i)
+		if (impls[i].supported()) names[n++] = impls[i].name;
+	names[n] = NULL;
+	return names;
+}
@@ -0,0 +1,27 @@
+// scan.h
+// Vectorized '\r'/'\n' search used by the tokenizer. The implementation
+// (AVX2, SSE2, NEON or scalar) is picked once at startup from what the
+// CPU supports; SIGCLIENT_SCAN=scalar|sse2|avx2|neon forces one.
+
+#ifndef SIGCLIENT_SCAN_H
+#define SIGCLIENT_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Store the offsets of all delimiters in buf[0..len) into pos, at most
+// max of them. Returns the number stored.
+size_t sc_scan_delims(const char *buf, size_t len, uint32_t *pos, size_t max);
+
+// Offset of the last delimiter in buf[0..len), or -1 if there is none
+long sc_scan_last_delim(const char *buf, size_t len);
+
+// Pick the best implementation (called by sc_client_init)
+void sc_scan_init(void);
+// Force an implementation by name; -1 if unknown or unsupported here
+int sc_scan_select(const char *name);
+const char *sc_scan_impl(void);
+// Names of compiled-in implementations usable on this CPU, NULL-terminated
+const char *const *sc_scan_available(void);
+
+#endif
@@ -0,0 +1,121 @@
+// sched.c
+// Window tick scheduler. Ticks are kept on CLOCK_MONOTONIC so NTP steps
+// and slews cannot stretch or repeat a window, and fire from a timerfd
+// armed with an absolute expiry, which the event backend waits on like
+// any socket (ns resolution instead of the ms wait timeout). The first
+// tick is aligned to a wall-clock multiple of the period; after that
+// the epoch timestamp simply advances with the monotonic schedule and
+// is only used for output.
+//
+// Catch-up policy: when a tick fires more than a period late, the
+// windows that were missed entirely are skipped (counted in `skipped`),
+// not replayed, and the next tick stays on the original grid.
+
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include "sigclient.h"
+
+#define NS_PER_MS 1000000LL
+
+static long long ts_ns(const struct timespec *ts) {
+	return (long long)ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+long long sc_mono_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts_ns(&ts);
+}
+
+static int arm(struct sc_sched *t) {
+#ifdef __linux__
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = t->next_ns / 1000000000LL;
+	its.it_value.tv_nsec = t->next_ns % 1000000000LL;
+	return timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &its, NULL);
+#else
+	(void)t;
+	return -1;
+#endif
+}
+
+static void open_timer(struct sc_sched *t) {
+	t->fd = -1;
+#ifdef __linux__
+	t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (t->fd >= 0 && arm(t) < 0) sc_sched_free(t);
+#endif
+}
+
+void sc_sched_init(struct sc_sched *t, long long period_ns) {
+	memset(t, 0, sizeof(*t));
+	t->period_ns = period_ns;
+
+	struct timespec rt, mt;
+	clock_gettime(CLOCK_REALTIME, &rt);
+	clock_gettime(CLOCK_MONOTONIC, &mt);
+	long long epoch = ts_ns(&rt);
+	long long first = epoch - epoch % period_ns + period_ns;
+	t->next_epoch_ns = first;
+	t->next_ns = ts_ns(&mt) + (first - epoch);
+	open_timer(t);
+}
+
+// Same grid as `from`, with a timerfd of its own (shard workers tick in
+// step with the merging thread)
+void sc_sched_clone(struct sc_sched *t, const struct sc_sched *from) {
+	memset(t, 0, sizeof(*t));
+	t->period_ns = from->period_ns;
+	t->next_ns = from->next_ns;
+	t->next_epoch_ns = from->next_epoch_ns;
+	open_timer(t);
+}
+
+void sc_sched_free(struct sc_sched *t) {
+	if (t->fd >= 0) close(t->fd);
+	t->fd = -1;
+}
+
+// Wait timeout until the next tick, rounded up so a ms timeout never
+// wakes early; -1 when the timerfd wakes the loop instead
+long long sc_sched_timeout_ms(const struct sc_sched *t, long long now_ns) {
+	if (t->fd >= 0) return -1;
+	long long d = t->next_ns - now_ns;
+	return d <= 0 ? 0 : (d + NS_PER_MS - 1) / NS_PER_MS;
+}
+
+// Drain the timerfd after it was reported readable
+void sc_sched_clear(struct sc_sched *t) {
+	uint64_t expirations;
+	ssize_t r = read(t->fd, &expirations, sizeof(expirations));
+	(void)r;    // EAGAIN if already drained
+}
+
+// Record the lateness of the tick that fires at now_ns
+void sc_sched_fire(struct sc_sched *t, long long now_ns) {
+	long long late = now_ns - t->next_ns;
+	t->ticks++;
+	t->late_last_ns = late;
+	t->late_sum_ns += late;
+	if (late > t->late_max_ns) t->late_max_ns = late;
+}
+
+// Move past the tick handled at now_ns to the next one on the grid (see
+// the catch-up policy above). Returns -1 if the timerfd could not be
+// re-armed; the caller then drops it.
+int sc_sched_advance(struct sc_sched *t, long long now_ns) {
+	// first grid point after now_ns, in one step however long the stall
+	long long n = now_ns >= t->next_ns ? (now_ns - t->next_ns) / t->period_ns + 1 : 1;
+	t->next_ns += n * t->period_ns;
+	t->next_epoch_ns += n * t->period_ns;
+	t->skipped += n - 1;
+	return t->fd >= 0 ? arm(t) : 0;
+}
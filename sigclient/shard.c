@@ -0,0 +1,163 @@
+// shard.c
+// Sharded ingest (-j N): the streams are split into N contiguous slices,
+// each owned by a worker thread pinned to its own core, with a private
+// event loop, connection table, buffers and timerfd on the same window
+// grid as the main loop. Nothing is shared while a window is open.
+//
+// At its tick a worker copies the window state of its streams into one
+// of two slots (chosen by window parity), stamps the slot with the window
+// number and moves on; it never waits for the merge. The main loop ticks
+// on the same grid, waits briefly for every shard's slot to carry the
+// current window number, copies it into its merged table and runs the
+// usual tick callback on that. The stamp is cleared before a slot is
+// rewritten and checked again after the copy, so a slot being reused
+// under a slow merge is detected instead of read torn. A shard that does
+// not deliver within half a window is reported absent for that window.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "sigclient.h"
+
+int sc_shards_init(struct sc_client *c, const struct sc_options *opts) {
+	int n = opts->shards;
+	if (n > c->nconns) n = c->nconns;
+	if (n < 1) n = 1;
+	c->shards = sc_arena_array(c->arena, n, sizeof(*c->shards));
+	if (!c->shards) return -1;
+	c->nshards = n;
+	for (int k = 0; k < n; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		sh->first = (int)((long long)k * c->nconns / n);
+		int count = (int)((long long)(k + 1) * c->nconns / n) - sh->first;
+		sh->cpu = sc_cpu_nth(k);
+		for (int j = 0; j < 2; ++j) {
+			atomic_init(&sh->slot[j].window, -1);
+			sh->slot[j].vals = sc_arena_array(c->arena, count, sizeof(*sh->slot[j].vals));
+			if (!sh->slot[j].vals) return -1;
+		}
+		if (sc_client_init_slice(&sh->client, opts, c->window_ns, sh->first, count, c->arena) < 0) return -1;
+	}
+	return 0;
+}
+
+void sc_shards_free(struct sc_client *c) {
+	for (int k = 0; k < c->nshards; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		if (sh->client.conns) sc_client_free(&sh->client);
+	}
+	c->shards = NULL;
+	c->nshards = 0;
+}
+
+// Worker tick: publish the window that just ended
+static void publish(struct sc_client *w, long long ts_ns, void *arg) {
+	(void)ts_ns;
+	struct sc_shard *sh = arg;
+	long long k = (w->sched.next_ns - sh->base_ns) / w->sched.period_ns;
+	struct sc_shard_slot *slot = &sh->slot[k & 1];
+
+	atomic_store_explicit(&slot->window, -1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	for (int i = 0; i < w->nconns; ++i) {
+		const struct sc_conn *conn = &w->conns[i];
+		struct sc_shard_value *v = &slot->vals[i];
+		v->have = conn->have;
+		if (conn->have) {
+			v->len = conn->lat_len;
+			memcpy(v->tok, conn->inbuf + conn->lat_off, (size_t)conn->lat_len + 1);
+			v->value = conn->value;
+			v->value_ns = conn->value_ns;
+		}
+		if (conn->stats) v->stats = *conn->stats;
+	}
+	atomic_store_explicit(&slot->window, k, memory_order_release);
+}
+
+static void *worker_main(void *arg) {
+	struct sc_shard *sh = arg;
+	if (sh->cpu >= 0) sc_pin_thread(sh->cpu);
+	if (sc_client_run(&sh->client, publish, sh) < 0)
+		fprintf(stderr, "sigclient: shard event loop failed: %s\n", strerror(errno));
+	return NULL;
+}
+
+// Start the workers on the main loop's window grid
+int sc_shards_start(struct sc_client *c) {
+	c->shard_base_ns = c->sched.next_ns;
+	for (int k = 0; k < c->nshards; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		struct sc_client *w = &sh->client;
+		sh->base_ns = c->shard_base_ns;
+		sc_sched_clone(&w->sched, &c->sched);
+		if (w->sched.fd >= 0 && sc_ev_add(w->ev, w->sched.fd, SC_EV_IN, &w->sched) < 0) sc_sched_free(&w->sched);
+		atomic_store(&w->stopping, 0);
+		int err = pthread_create(&sh->thread, NULL, worker_main, sh);
+		if (err) {
+			sc_shards_stop(c);
+			errno = err;
+			return -1;
+		}
+		sh->running = 1;
+	}
+	return 0;
+}
+
+void sc_shards_stop(struct sc_client *c) {
+	for (int k = 0; k < c->nshards; ++k)
+		if (c->shards[k].running) atomic_store(&c->shards[k].client.stopping, 1);
+	for (int k = 0; k < c->nshards; ++k) {
+		struct sc_shard *sh = &c->shards[k];
+		if (!sh->running) continue;
+		pthread_join(sh->thread, NULL);
+		sh->running = 0;
+		if (sh->missed)
+			fprintf(stderr, "sigclient: shard %d (cpu %d): %lld windows merged without it\n", k, sh->cpu, sh->missed);
+	}
+}
+
+// Copy shard sh's slice of the current window into the merged table;
+// 0 if the slot did not hold that window (late worker or torn copy)
+static int merge_one(struct sc_client *c, struct sc_shard *sh, long long k, long long deadline) {
+	struct sc_shard_slot *slot = &sh->slot[k & 1];
+	long long w;
+	while ((w = atomic_load_explicit(&slot->window, memory_order_acquire)) < k && sc_mono_ns() < deadline)
+		sched_yield();
+	if (w != k) return 0;
+	for (int i = 0; i < sh->client.nconns; ++i) {
+		const struct sc_shard_value *v = &slot->vals[i];
+		struct sc_conn *view = &c->conns[sh->first + i];
+		view->have = v->have;
+		if (v->have) {
+			memcpy(view->inbuf, v->tok, (size_t)v->len + 1);
+			view->lat_off = 0;
+			view->lat_len = v->len;
+			view->value = v->value;
+			view->value_ns = v->value_ns;
+		}
+		if (view->stats) *view->stats = v->stats;
+	}
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&slot->window, memory_order_relaxed) == k;
+}
+
+// Assemble the window that ends at the tick being handled
+void sc_shards_merge(struct sc_client *c) {
+	long long k = (c->sched.next_ns - c->shard_base_ns) / c->window_ns;
+	long long deadline = c->sched.next_ns + c->window_ns / 2;
+	for (int s = 0; s < c->nshards; ++s) {
+		struct sc_shard *sh = &c->shards[s];
+		if (merge_one(c, sh, k, deadline)) continue;
+		sh->missed++;
+		for (int i = 0; i < sh->client.nconns; ++i) {
+			struct sc_conn *view = &c->conns[sh->first + i];
+			view->have = 0;
+			if (view->stats) sc_stats_reset(view->stats);
+		}
+	}
+}
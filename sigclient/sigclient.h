@@ -0,0 +1,606 @@
+// sigclient.h
+// Shared ingest core used by client1 and client2: owns the per-stream
+// connection state, input buffering, newline tokenizing and the aligned
+// output tick. The clients only configure it and handle each tick.
+
+#ifndef SIGCLIENT_H
+#define SIGCLIENT_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <netinet/in.h>
+
+#include "event.h"
+#include "numparse.h"
+#include "stats.h"
+#include "metrics.h"
+#include "feed.h"
+
+#define SC_BUF_SIZE 2048        // receive buffer a stream starts with (and shrinks back to)
+#define SC_BUF_MAX (64 << 10)   // largest it grows to, also its slab slot
+#define SC_BUF_SHRINK_MS 2000   // light traffic this long halves a grown buffer
+#define SC_RCVBUF_MAX (4 << 20) // SO_RCVBUF bound when a full-size buffer is not enough
+#define SC_RECV_BUF_SIZE 4096   // io_uring provided buffers (multishot recv)
+#define SC_TOKEN_MAX 512
+#define SC_NAME_MAX 32
+#define SC_HOST_MAX 256        // host names up to the DNS limit
+#define SC_MAX_WAIT_MS 1000     // upper bound for a single wait in the loop
+#define SC_NS_PER_MS 1000000LL
+#define SC_MIN_WINDOW_NS 1000LL // -w lower bound (1 us)
+#define SC_CAPTURE_SEGMENT (64LL << 20)  // default capture segment size
+#define SC_RING_SLOTS 1024      // default -T ring size (records)
+#define SC_MAX_SHARDS 64        // -j upper bound
+
+// Reconnect backoff: the delay doubles per failed attempt between MIN and
+// MAX, and the actual wait is drawn from [delay/2, delay] (equal jitter)
+// so streams behind the same restarted server do not retry in lockstep.
+#define SC_RECONNECT_MIN_MS 100
+#define SC_RECONNECT_MAX_MS 5000
+#define SC_CONNECT_TIMEOUT_MS 2000  // give up on a connect still in progress
+
+#define SC_DEFAULT_HOST "127.0.0.1"
+#define SC_DEFAULT_PORTS {4001, 4002, 4003}
+
+// Assigning samples to windows by arrival time (-A): the loop's window
+// clock, shared by its streams
+enum sc_arrival_mode {
+	SC_ARRIVAL_OFF,     // a sample belongs to the window that handles it
+	SC_ARRIVAL_LOOP,    // stamped with the loop's clock read per wakeup
+	SC_ARRIVAL_KERNEL,  // stamped by the kernel on receipt (SO_TIMESTAMPNS)
+};
+
+struct sc_arrival {
+	enum sc_arrival_mode mode;
+	int interp;             // estimate numeric values at the window end
+	long long close_ns;     // end of the open window (monotonic)
+	long long rt_off_ns;    // CLOCK_REALTIME - CLOCK_MONOTONIC, for kernel stamps
+};
+
+// -A state of one stream, indexed like sc_client.conns and allocated only
+// with -A, so the hot table stays small without it: samples stamped at or
+// after clock->close_ns wait in the next window's slot until the tick has
+// handled the open one
+struct sc_arrival_conn {
+	const struct sc_arrival *clock;
+	long long rx_ns;        // arrival time of the data being fed
+	int next_have, next_off, next_len;
+	double next_value;
+	long long next_ns;
+	struct sc_stats *next_stats;
+	double prev_value;      // the numeric sample before the newest one
+	long long prev_ns;
+	double after_value;     // first numeric sample of the next window
+	long long after_ns;
+};
+
+// Hot per-stream state, touched on every wakeup. Kept small so the
+// whole table scans in a few cache lines.
+struct sc_conn {
+	int fd;
+	int inlen;          // bytes in inbuf
+	int start;          // offset of the incomplete line being received
+	int have;           // window has a value at inbuf + lat_off
+	int lat_off;
+	int lat_len;
+	int state;          // enum sc_conn_state
+	int numeric;        // parse each value into `value` on arrival
+	int fresh;          // a value arrived in the reads being handled
+	int notify;         // call the client's on_sample hook on arrival
+	int cap;            // inbuf size, SC_BUF_SIZE..SC_BUF_MAX
+	int full;           // reads in a row that filled the free tail
+	int peak;           // largest read since the last sc_conn_adapt
+	int discarding;     // inside a line too long for SC_BUF_MAX: skip to its end
+	char *inbuf;        // slot of sc_client.bufs, NULL while released
+	double value;       // numeric: parsed value, SC_ABSENT if not a number
+	long long value_ns; // monotonic time the loop received the value
+	struct sc_stats *stats; // aggregated streams: every sample of the window
+	struct sc_metrics_stream *metrics;  // -M counters, NULL if off
+	long long light_since;  // ms time reads started staying under cap / 4, 0 if not
+	struct sc_arrival_conn *arrival;    // -A, NULL if off
+};
+
+enum sc_conn_state {
+	SC_CONN_IDLE,       // no socket, retry at next_try
+	SC_CONN_CONNECTING, // non-blocking connect in flight, waiting for writable
+	SC_CONN_UP,
+};
+
+// TCP options of a stream's socket (-O, or "@opts" in its spec), set
+// before it connects
+#define SC_SOCK_NODELAY   0x1u
+#define SC_SOCK_QUICKACK  0x2u  // the kernel clears it again, so re-set after every read
+#define SC_SOCK_KEEPALIVE 0x4u
+#define SC_SOCK_TOS       0x8u  // IP_TOS, or IPV6_TCLASS on IPv6
+
+struct sc_sockopts {
+	unsigned flags;             // SC_SOCK_*
+	int keep_idle_s, keep_intvl_s, keep_count;  // keepalive, 0 = system default
+	int tos;
+};
+
+struct sc_resolve;
+
+// Cold per-stream state: configuration and reconnect bookkeeping, only
+// used when connecting.
+struct sc_stream {
+	char name[SC_NAME_MAX];
+	struct sockaddr_storage addr;   // IPv4 or IPv6
+	socklen_t addrlen;
+	struct sc_sockopts sock;
+	struct sc_resolve *resolve; // host name: looked up again after a drop, NULL for literals
+	long long next_try;         // IDLE: earliest next connect attempt
+	long long connect_started;  // CONNECTING: when connect() was issued
+	int backoff_ms;             // current backoff step, 0 after a success
+	unsigned agg;               // SC_AGG_* fields printed, 0 = plain value
+};
+
+// One "[name=][host:]port[/fields][@sockopts]" entry from -s or the
+// config file; host is a name, an IPv4 address or a [bracketed] IPv6 one
+struct sc_stream_spec {
+	char name[SC_NAME_MAX];
+	char host[SC_HOST_MAX];
+	int port;
+	int agg_set;        // has its own /fields list (may be "none")
+	unsigned agg;
+	int sock_set;       // has its own @sockopts (may be "none")
+	struct sc_sockopts sock;
+};
+
+// Output record format (-o)
+enum sc_out_format {
+	SC_OUT_JSON,        // JSON lines (default)
+	SC_OUT_BIN,         // fixed-size binary records, see binfmt.h
+};
+
+// When buffered output lines are written (-f)
+enum sc_flush_policy {
+	SC_FLUSH_TICK,      // every tick (default)
+	SC_FLUSH_TICKS,     // every flush_arg ticks
+	SC_FLUSH_SIZE,      // once flush_arg bytes are buffered
+	SC_FLUSH_DEADLINE,  // at the first tick flush_arg ns after the oldest buffered line
+};
+
+// What the ingest loop does when the writer thread's ring is full (-T)
+enum sc_ring_policy {
+	SC_RING_BLOCK,          // wait for the writer (never loses records)
+	SC_RING_DROP_OLDEST,    // overwrite the oldest queued record
+	SC_RING_DROP_NEWEST,    // discard the record being published
+};
+
+// Run-time settings shared by both clients (see sc_options_parse)
+struct sc_options {
+	enum sc_ev_backend backend;
+	struct sc_stream_spec *streams;
+	int nstreams;
+	int numeric;        // -n: parse values on arrival, print JSON numbers
+	unsigned agg;       // -a: fields for streams without their own list
+	enum sc_arrival_mode arrival;   // -A
+	int interp;                     // -A ...,interp
+	struct sc_sockopts sock;    // -O: socket options for streams without their own
+	int lateness;       // -l: print each tick's lateness
+	long long window_ns;    // -w: window length, 0 = the client's default
+	int timestamp_us;   // -u: print "timestamp_us" instead of ms
+	enum sc_flush_policy flush;     // -f
+	long long flush_arg;
+	enum sc_out_format format;      // -o
+	char *capture_dir;              // -C: binary segments instead of stdout
+	long long rotate_bytes;         // -r size=: segment size limit
+	long long rotate_ns;            // -r time=: segment age limit
+	int threaded;                   // -T: hand records to a writer thread
+	enum sc_ring_policy ring_policy;
+	unsigned ring_slots;
+	int shards;                     // -j: worker threads, 0 = ingest on the tick thread
+	int on_arrival;                 // -E: run control rules per sample, not per tick
+	char *rules_path;               // -R: control rule table (client2)
+	double ctrl_rate;               // -L: control writes per second per target, 0 = unlimited
+	int ctrl_burst;
+	long long spin_idle_ns;         // -S: spin the loop, blocking after this long idle
+	int busy_poll_us;               // -S busy=: SO_BUSY_POLL on stream sockets
+	long long metrics_ns;           // -M: snapshot interval, 0 = no metrics
+	int metrics_stderr;             // -M ...,stderr (the default without shm=)
+	char *metrics_shm;              // -M ...,shm=NAME: shared-memory page
+	char *feed_shm;                 // -P shm=NAME: broadcast ring of the output records
+	unsigned feed_slots;            // -P slots=N
+	char *feed_unix;                // -P unix=PATH: subscriber socket
+	long long analysis_ns;          // -F: analysis record interval, 0 = no analysis
+	unsigned analysis_len;          // -F ...,n=N: windows analysed per stream
+};
+
+// Window scheduler (sched.c): monotonic ticks woken by a timerfd
+struct sc_sched {
+	int fd;                     // timerfd, -1 if unavailable (wait timeouts then)
+	long long period_ns;
+	long long next_ns;          // CLOCK_MONOTONIC time of the next tick
+	long long next_epoch_ns;    // its wall-clock timestamp, for output only
+	long long ticks;            // fired ticks
+	long long skipped;          // windows skipped by the catch-up policy
+	long long late_last_ns;     // fire time - scheduled time
+	long long late_max_ns;
+	long long late_sum_ns;
+};
+
+// Capture sink (capture.c): binary records written straight into
+// mmapped, rotating segment files plus a timestamp index
+struct sc_capture {
+	char *dir;
+	char *header;               // schema header copied to every segment
+	size_t header_len, record_size;
+	long long max_ns;           // rotate after this long, 0 = size only
+	int seg_fd;
+	char *seg;                  // mapped open segment, NULL if none
+	size_t seg_size, seg_len;
+	int idx_fd;
+	char *idx;                  // mapped index file
+	size_t idx_size;
+	int failed;                 // last segment open failed (reported once)
+};
+
+// SPSC record ring (ring.c) between the ingest loop and the writer thread
+struct sc_ring {
+	_Alignas(64) atomic_ullong head;    // next slot to publish, producer side
+	_Alignas(64) atomic_ullong tail;    // oldest queued slot, consumer side
+	_Alignas(64) char *slots;
+	size_t stride, slot_size;
+	unsigned mask;                      // slots - 1 (power of two)
+	enum sc_ring_policy policy;
+	sem_t items;                        // wakes the consumer
+	// producer-side counters
+	long long dropped_oldest, dropped_newest;
+	long long blocked;                  // times the producer had to wait
+	unsigned long long high_water;      // deepest queue seen
+};
+
+// A Unix socket subscriber of the feed
+struct sc_feed_sub {
+	int fd;                     // -1 if the slot is free
+	char *backlog;              // SC_FEED_BACKLOG bytes, what the socket did not take yet
+	size_t len;
+};
+
+// Output fan-out (feed.c, -P): shared-memory ring and/or Unix socket
+struct sc_feed {
+	struct sc_feed_page *page;  // NULL without a ring
+	size_t page_size;
+	char *shm_name;
+	char *slots;
+	size_t slot_size;
+	unsigned mask;              // nslots - 1
+	int listen_fd;              // -1 without a socket
+	char *path;
+	struct sc_feed_sub subs[SC_FEED_MAX_SUBS];
+	const char *header;         // binary schema header, sent to each new subscriber first
+	size_t header_len;
+	long long next_accept_ms;
+	long long served, dropped;  // subscribers accepted / dropped for falling behind
+};
+
+// Streaming analysis (analysis.c, -F). The tick thread queues every
+// window's values into rows; a background thread keeps the last len of
+// them per stream and every `every` rows encodes an analysis line into
+// results, which the tick thread then writes with its output.
+#define SC_ANALYSIS_LEN 256         // default windows analysed per stream
+#define SC_ANALYSIS_MIN 16          // fewest windows a stream is analysed over
+#define SC_ANALYSIS_HARMONICS 8     // harmonics the shape is judged from
+#define SC_ANALYSIS_ROWS 256        // queued rows before new ones are dropped
+#define SC_ANALYSIS_RESULTS 16      // queued lines before new ones are dropped
+
+// One stream's history on the analysis thread, indexed by sample number
+// & (len - 1). Windows without a sample hold the previous value.
+struct sc_analysis_stream {
+	double *x;
+	unsigned char *have;            // the window had a sample of its own
+	unsigned long long *maxq, *minq;    // monotonic deques of sample numbers
+	unsigned maxh, maxt, minh, mint;    // their head and tail counters
+	unsigned long long n;           // values pushed, from the first sample on
+	unsigned filled, present;       // values in x, and how many were samples
+	double held;                    // NaN before the first sample
+	double sum, sumsq;              // over x, for the running mean and RMS
+};
+
+struct sc_analysis {
+	struct sc_ring rows;            // tick -> analysis thread: ts_ns + nconns doubles
+	struct sc_ring results;         // analysis -> tick thread: JSON lines
+	pthread_t thread;
+	atomic_int closing;
+	const struct sc_stream *streams;
+	int nconns;
+	int timestamp_us;
+	unsigned len;                   // a power of two
+	unsigned every, since;          // rows per record, rows since the last one
+	double fs;                      // windows per second
+	size_t row_size, line_max;
+	char *rowbuf;                   // drained rows (analysis thread)
+	char *line;                     // line being encoded (analysis thread)
+	char *take;                     // drained lines (tick thread)
+	struct sc_analysis_stream *st;
+	double *re, *im, *mag;          // FFT work space, len entries
+	double *cosv, *sinv;            // twiddles: cos(2 pi k / len), k < len; -sin, k < len / 2
+};
+
+// Output encoder (output.c): lines are built from per-stream key
+// templates rendered at start-up into one preallocated buffer
+struct sc_out {
+	int fd;
+	enum sc_out_format format;
+	int ncols;                  // binary: columns per record
+	char *buf;
+	size_t len, cap;
+	size_t max_line;            // worst-case encoded line
+	char *tmpl;                 // ", \"name\"<pad>: " per stream, back to back
+	unsigned *tmpl_off;         // nconns + 1 offsets into tmpl
+	enum sc_flush_policy policy;
+	long long flush_arg;
+	long long pending;          // lines buffered
+	long long first_ns;         // monotonic time of the oldest buffered line
+	int capturing;              // records go to capture instead of fd
+	struct sc_capture capture;
+	int threaded;               // records go through ring to the writer thread
+	struct sc_ring ring;
+	pthread_t writer;
+	atomic_int closing;
+	int feeding;                // records are also published to feed
+	struct sc_feed feed;
+};
+
+struct sc_shard;
+struct sc_client;
+
+// Called as soon as a new value of a stream registered with
+// sc_client_notify has been received and parsed, before the window ends.
+// stream is the index in the merged table; c is the shard's client when
+// sharded (see shard.c).
+typedef void (*sc_sample_fn)(struct sc_client *c, int stream, double value, long long value_ns, void *arg);
+
+// Called when a watched fd is readable (readable = 1) or its deadline
+// has passed (readable = 0). Returns the next deadline (monotonic ns),
+// 0 for none.
+typedef long long (*sc_watch_fn)(struct sc_client *c, int readable, long long now_ns, void *arg);
+
+// An extra fd served by a client's event loop (sc_client_watch)
+struct sc_watch {
+	int fd;             // -1 if none
+	sc_watch_fn fn;
+	void *arg;
+	long long due_ns;   // 0 = no deadline
+};
+
+// Spin mode (-S): the loop polls with a zero timeout while events keep
+// coming and blocks again once idle_ns pass without any
+struct sc_spin {
+	long long idle_ns;          // 0 = off
+	int busy_poll_us;
+	int cpu;                    // loop thread pinned to, -1 = not pinned here
+	long long last_event_ns;
+	long long polls;            // zero-timeout waits
+	long long empty;            // ... that returned nothing
+	long long blocks;           // waits that could sleep
+	int busy_poll_failed;       // reported once
+};
+
+// Startup arena (arena.c): all of a client's memory, sealed once it runs
+struct sc_arena {
+	struct sc_arena_block *blocks;
+	size_t mapped;              // bytes mapped: the bound for the run
+	size_t used;                // bytes handed out
+	int sealed;
+};
+
+// Fixed-size slots from an arena with a free list (arena.c)
+struct sc_pool {
+	char *base;                 // count * size bytes
+	size_t size;
+	unsigned count, avail;
+	char *free;
+};
+
+// Live metrics of one loop (metrics.c, -M), snapshotted at its ticks
+struct sc_metrics {
+	struct sc_metrics_loop loop;
+	struct sc_metrics_stream *streams;  // the loop's sockets (conns order)
+	struct sc_metrics_stream *prev;     // as of the last snapshot, for rates
+	int nstreams;
+	int index;                          // section of the shared page
+	int to_stderr;
+	long long interval_ns, next_ns, last_ns;
+	struct sc_metrics_section *section; // NULL without a shared page
+};
+
+struct sc_client {
+	struct sc_conn *conns;      // hot, nconns entries
+	struct sc_stream *streams;  // cold, same index
+	struct sc_pool bufs;        // SC_BUF_MAX receive buffer slots, nconns of them
+	struct sc_arena *arena;     // shared with the shards
+	int owns_arena;
+	struct sc_stats *stats;     // nconns entries, used by aggregated streams
+	struct sc_arrival_conn *arrival_conns;  // -A: nconns entries, NULL if off
+	int nconns;
+	int base;                   // merged-table index of conns[0] (shards)
+	long long window_ns;
+	struct sc_sched sched;
+	struct sc_evloop *ev;
+	struct sc_arrival arrival;  // -A window clock, see struct sc_arrival_conn
+	int fixed_bufs;             // inbufs registered as io_uring buffer 0
+	int multishot;              // io_uring multishot recv into provided buffers
+	long long next_connect_due; // earliest next_try/connect timeout of any stream
+	unsigned long long rng;     // backoff jitter state
+	int numeric;                // print values as JSON numbers / null
+	int lateness;               // add "late_us" (tick lateness) to the output
+	int timestamp_us;           // epoch us timestamps instead of ms
+	struct sc_out out;
+	sc_sample_fn on_sample;
+	void *sample_arg;
+	struct sc_watch watch;
+	struct sc_spin spin;
+	struct sc_metrics *metrics;         // -M, NULL if off
+	struct sc_analysis *analysis;       // -F, NULL if off
+	struct sc_metrics_page *metrics_page;   // tick loop: the shared page
+	size_t metrics_page_size;
+	char *metrics_name;
+	struct sc_shard *shards;    // -j: workers owning slices of the streams;
+	int nshards;                // conns is then only the merged view
+	long long shard_base_ns;    // monotonic time of window 0 of the shard grid
+	atomic_int stopping;        // shard worker: leave sc_client_run
+};
+
+// Window state of one stream as published by its shard
+struct sc_shard_value {
+	int have;
+	int len;
+	double value;
+	long long value_ns;
+	struct sc_stats stats;
+	char tok[SC_TOKEN_MAX];
+};
+
+// Slot for every other window (seqlock-style: `window` is the window it
+// holds, -1 while the worker rewrites it)
+struct sc_shard_slot {
+	_Alignas(64) atomic_llong window;
+	struct sc_shard_value *vals;
+};
+
+// Shard (shard.c): a worker thread with its own event loop, buffers and
+// timer over streams [first, first + client.nconns) of the merged table
+struct sc_shard {
+	struct sc_client client;
+	int first;
+	int cpu;                    // pinned to, -1 = not pinned
+	long long base_ns;
+	struct sc_shard_slot slot[2];
+	pthread_t thread;
+	int running;
+	long long missed;           // windows the merge gave up waiting for
+};
+
+// Called once per window with the scheduled tick time in epoch ns
+// (aligned to window_ns boundaries). Window flags are reset after it
+// returns; c->sched holds the lateness of the tick being handled.
+typedef void (*sc_tick_fn)(struct sc_client *c, long long ts_ns, void *arg);
+
+// util.c
+long long sc_epoch_ms_now(void);
+long long sc_mono_ms(void);
+int sc_set_nonblocking(int fd);
+void sc_trim(char *s);
+unsigned long long sc_rand_next(unsigned long long *state);
+int sc_cpu_nth(int k);
+int sc_pin_thread(int cpu);
+
+// arena.c
+struct sc_arena *sc_arena_create(void);
+void sc_arena_destroy(struct sc_arena *a);
+void *sc_arena_alloc(struct sc_arena *a, size_t n, size_t align);
+void *sc_arena_array(struct sc_arena *a, size_t count, size_t size);
+void sc_arena_seal(struct sc_arena *a);
+int sc_pool_init(struct sc_pool *p, struct sc_arena *a, size_t size, unsigned count, size_t align);
+void *sc_pool_get(struct sc_pool *p);
+void sc_pool_put(struct sc_pool *p, void *obj);
+
+// options.c
+void sc_options_init(struct sc_options *o);
+int sc_options_parse(struct sc_options *o, int argc, char **argv);
+int sc_options_add_stream(struct sc_options *o, const char *spec);
+int sc_options_parse_sockopts(const char *s, struct sc_sockopts *out);
+int sc_options_load(struct sc_options *o, const char *path);
+void sc_options_free(struct sc_options *o);
+
+// sched.c
+long long sc_mono_ns(void);
+void sc_sched_init(struct sc_sched *t, long long period_ns);
+void sc_sched_clone(struct sc_sched *t, const struct sc_sched *from);
+void sc_sched_free(struct sc_sched *t);
+long long sc_sched_timeout_ms(const struct sc_sched *t, long long now_ns);
+void sc_sched_clear(struct sc_sched *t);
+void sc_sched_fire(struct sc_sched *t, long long now_ns);
+int sc_sched_advance(struct sc_sched *t, long long now_ns);
+
+// conn.c
+int sc_connect_start(const struct sockaddr *addr, socklen_t addrlen, const struct sc_sockopts *opts,
+		int *in_progress);
+int sc_stream_resolve(struct sc_stream *s, const char *host, int port);
+void sc_stream_refresh(struct sc_stream *s);
+void sc_stream_poll_resolve(struct sc_stream *s);
+void sc_stream_resolve_free(struct sc_stream *s);
+void sc_conn_quickack(struct sc_conn *c);
+void sc_conn_init(struct sc_conn *c, struct sc_stream *s, char *inbuf);
+int sc_conn_start(struct sc_conn *c, struct sc_stream *s, long long now);
+int sc_conn_finish(struct sc_conn *c, struct sc_stream *s);
+void sc_conn_retry_later(struct sc_conn *c, struct sc_stream *s, long long now, unsigned long long *rng);
+void sc_conn_close(struct sc_conn *c);
+int sc_conn_reserve(struct sc_conn *c);
+int sc_conn_read(struct sc_conn *c);
+void sc_conn_align(struct sc_conn *c, long long end_ns);
+void sc_conn_next_window(struct sc_conn *c);
+void sc_conn_feed(struct sc_conn *c, size_t n);
+void sc_conn_copy_in(struct sc_conn *c, const char *data, size_t n);
+void sc_conn_count_read(struct sc_conn *c, size_t n, int full);
+void sc_conn_adapt(struct sc_conn *c, long long now);
+char *sc_conn_release(struct sc_conn *c);
+const char *sc_conn_value(const struct sc_conn *c);
+double sc_conn_number(const struct sc_conn *c);
+
+// client.c
+int sc_client_init(struct sc_client *c, const struct sc_options *opts, long long window_ns);
+int sc_client_init_slice(struct sc_client *c, const struct sc_options *opts, long long window_ns, int first, int n,
+		struct sc_arena *arena);
+void sc_client_free(struct sc_client *c);
+int sc_client_find(const struct sc_client *c, const char *name);
+const char *sc_client_value(const struct sc_client *c, int i);
+void sc_client_set_numeric(struct sc_client *c, int i);
+double sc_client_number(const struct sc_client *c, int i);
+long long sc_client_value_ns(const struct sc_client *c, int i);
+void sc_client_notify(struct sc_client *c, int i, sc_sample_fn fn, void *arg);
+int sc_client_watch(struct sc_client *c, int owner, int fd, sc_watch_fn fn, void *arg);
+void sc_client_watch_due(struct sc_client *c, long long due_ns);
+int sc_client_run(struct sc_client *c, sc_tick_fn on_tick, void *arg);
+void sc_client_stop_on_signals(void);
+
+// shard.c
+int sc_shards_init(struct sc_client *c, const struct sc_options *opts);
+void sc_shards_free(struct sc_client *c);
+int sc_shards_start(struct sc_client *c);
+void sc_shards_stop(struct sc_client *c);
+void sc_shards_merge(struct sc_client *c);
+
+// capture.c
+int sc_capture_open(struct sc_capture *cp, const char *dir, const char *header, size_t header_len,
+		size_t record_size, long long max_bytes, long long max_ns);
+void sc_capture_close(struct sc_capture *cp);
+char *sc_capture_reserve(struct sc_capture *cp, long long ts_ns);
+void sc_capture_commit(struct sc_capture *cp, long long ts_ns);
+
+// ring.c
+int sc_ring_init(struct sc_ring *r, struct sc_arena *a, unsigned nslots, size_t slot_size, enum sc_ring_policy policy);
+void sc_ring_free(struct sc_ring *r);
+char *sc_ring_claim(struct sc_ring *r);
+void sc_ring_publish(struct sc_ring *r, size_t len);
+size_t sc_ring_drain(struct sc_ring *r, char *dst, size_t cap);
+
+// metrics.c
+int sc_metrics_init(struct sc_client *c, const struct sc_options *opts);
+void sc_metrics_free(struct sc_client *c);
+void sc_metrics_snapshot(struct sc_client *c, long long now_ns);
+
+// feed.c
+int sc_feed_open(struct sc_feed *f, struct sc_arena *a, const struct sc_options *opts, int format, long long window_ns,
+		const char *header, size_t header_len, size_t max_record);
+void sc_feed_close(struct sc_feed *f);
+void sc_feed_publish(struct sc_feed *f, const char *rec, size_t len);
+
+// analysis.c
+int sc_analysis_init(struct sc_client *c, const struct sc_options *opts);
+void sc_analysis_free(struct sc_client *c);
+void sc_analysis_push(struct sc_client *c, long long ts_ns);
+size_t sc_analysis_take(struct sc_analysis *a);
+
+// output.c
+int sc_out_init(struct sc_out *o, const struct sc_client *c, const struct sc_options *opts);
+void sc_out_free(struct sc_out *o);
+int sc_out_flush(struct sc_out *o);
+void sc_client_output(struct sc_client *c, long long ts_ns);
+int sc_client_flush(struct sc_client *c);
+
+#endif
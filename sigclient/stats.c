@@ -0,0 +1,83 @@
+// stats.c
+// Welford's update keeps mean and variance numerically stable without
+// storing samples: each sample costs a handful of flops and the state
+// is reset at every window boundary.
+
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+
+#include "numparse.h"
+#include "stats.h"
+
+static const char *const field_names[SC_AGG_NFIELDS] = {
+	"count", "min", "max", "mean", "var", "first", "last",
+};
+
+void sc_stats_reset(struct sc_stats *st) {
+	st->count = 0;
+	st->mean = st->m2 = 0.0;
+}
+
+void sc_stats_add(struct sc_stats *st, double x) {
+	if (st->count++ == 0) {
+		st->min = st->max = st->first = x;
+		st->mean = x;
+		st->m2 = 0.0;
+	} else {
+		if (x < st->min) st->min = x;
+		if (x > st->max) st->max = x;
+		double d = x - st->mean;
+		st->mean += d / st->count;
+		st->m2 += d * (x - st->mean);
+	}
+	st->last = x;
+}
+
+double sc_stats_field(const struct sc_stats *st, unsigned field) {
+	if (field == SC_AGG_COUNT) return (double)st->count;
+	if (st->count == 0) return SC_ABSENT;
+	switch (field) {
+	case SC_AGG_MIN: return st->min;
+	case SC_AGG_MAX: return st->max;
+	case SC_AGG_MEAN: return st->mean;
+	case SC_AGG_VAR: return st->m2 / st->count;
+	case SC_AGG_FIRST: return st->first;
+	case SC_AGG_LAST: return st->last;
+	}
+	return SC_ABSENT;
+}
+
+const char *sc_stats_field_name(int i) {
+	return field_names[i];
+}
+
+int sc_stats_parse_fields(const char *s, size_t len, unsigned *mask) {
+	unsigned m = 0;
+	while (len > 0) {
+		const char *comma = memchr(s, ',', len);
+		size_t n = comma ? (size_t)(comma - s) : len;
+		int found = 0;
+		if (n == 3 && memcmp(s, "all", 3) == 0) {
+			m |= (1u << SC_AGG_NFIELDS) - 1;
+			found = 1;
+		} else if (n == 4 && memcmp(s, "none", 4) == 0) {
+			found = 1;
+		}
+		for (int i = 0; i < SC_AGG_NFIELDS && !found; ++i) {
+			if (strlen(field_names[i]) == n && memcmp(s, field_names[i], n) == 0) {
+				m |= 1u << i;
+				found = 1;
+			}
+		}
+		if (!found) return -1;
+		s += n;
+		len -= n;
+		if (comma) {
+			s++;
+			len--;
+			if (len == 0) return -1;    // trailing comma
+		}
+	}
+	*mask = m;
+	return 0;
+}
@@ -0,0 +1,39 @@
+// stats.h
+// Streaming per-window statistics (Welford), O(1) memory per stream.
+
+#ifndef SIGCLIENT_STATS_H
+#define SIGCLIENT_STATS_H
+
+#include <stddef.h>
+
+// Fields selectable per output, printed in this order
+enum {
+	SC_AGG_COUNT = 1 << 0,
+	SC_AGG_MIN   = 1 << 1,
+	SC_AGG_MAX   = 1 << 2,
+	SC_AGG_MEAN  = 1 << 3,
+	SC_AGG_VAR   = 1 << 4,  // population variance of the window's samples
+	SC_AGG_FIRST = 1 << 5,
+	SC_AGG_LAST  = 1 << 6,
+	SC_AGG_NFIELDS = 7,
+};
+
+struct sc_stats {
+	long count;
+	double min, max;
+	double mean, m2;    // running mean and sum of squared deviations
+	double first, last;
+};
+
+void sc_stats_reset(struct sc_stats *st);
+void sc_stats_add(struct sc_stats *st, double x);
+// Value of one SC_AGG_* field, SC_ABSENT if the window had no samples
+double sc_stats_field(const struct sc_stats *st, unsigned field);
+
+// Field name of bit i (0 <= i < SC_AGG_NFIELDS)
+const char *sc_stats_field_name(int i);
+// Parse "min,max,mean" (or "all" / "none") into an SC_AGG_* mask.
+// Returns 0, or -1 on an unknown field.
+int sc_stats_parse_fields(const char *s, size_t len, unsigned *mask);
+
+#endif
@@ -0,0 +1,77 @@
+// util.c
+// Small helpers shared by the ingest core: clocks, fd flags, trimming,
+// CPU pinning.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include "sigclient.h"
+
+long long sc_epoch_ms_now(void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000LL + (tv.tv_usec / 1000LL);
+}
+
+// Monotonic ms for connect/backoff deadlines (immune to clock steps)
+long long sc_mono_ms(void) {
+	return sc_mono_ns() / 1000000LL;
+}
+
+int sc_set_nonblocking(int fd) {
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags == -1) return -1;
+	if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) return -1;
+	return 0;
+}
+
+// Trim leading/trailing whitespace
+void sc_trim(char *s) {
+	int i = 0, j = strlen(s) - 1;
+	while (i <= j && (s[i] == '\n' || s[i] == '\r' || s[i] == ' ' || s[i] == '\t')) i++;
+	while (j >= i && (s[j] == '\n' || s[j] == '\r' || s[j] == ' ' || s[j] == '\t')) j--;
+	if (i == 0 && j == (int)strlen(s) - 1) return;
+	if (i > j) { s[0] = '\0'; return; }
+	memmove(s, s + i, j - i + 1);
+	s[j - i + 1] = '\0';
+}
+
+// xorshift64*: cheap, good enough for retry jitter
+unsigned long long sc_rand_next(unsigned long long *state) {
+	unsigned long long x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 2685821657736338717ULL;
+}
+
+// The k-th CPU this process may run on, wrapping around; -1 if unknown
+int sc_cpu_nth(int k) {
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof(set), &set) < 0) return -1;
+	int n = CPU_COUNT(&set);
+	if (n == 0) return -1;
+	int want = k % n;
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		if (CPU_ISSET(cpu, &set) && want-- == 0) return cpu;
+	return -1;
+}
+
+// Pin the calling thread to cpu; prints and returns -1 on failure
+int sc_pin_thread(int cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (err) {
+		fprintf(stderr, "sigclient: pinning to cpu %d: %s\n", cpu, strerror(err));
+		return -1;
+	}
+	return 0;
+}